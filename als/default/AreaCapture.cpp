@@ -6,18 +6,29 @@
 
 #include "AreaCapture.h"
 
+#include <android-base/file.h>
+#include <android-base/parsedouble.h>
+#include <android-base/parseint.h>
 #include <android-base/properties.h>
+#include <android-base/stringprintf.h>
+#include <android-base/strings.h>
 #include <gui/SurfaceComposerClient.h>
 #include <gui/SyncScreenCaptureListener.h>
 #include <ui/DisplayState.h>
 #include <ui/PixelFormat.h>
 
+#include <algorithm>
 #include <cstdio>
+#include <sstream>
 #include <signal.h>
 #include <time.h>
 #include <unistd.h>
 
 using android::base::GetProperty;
+using android::base::ParseFloat;
+using android::base::ParseInt;
+using android::base::Split;
+using android::base::StringAppendF;
 using android::gui::ScreenCaptureResults;
 using android::ui::PixelFormat;
 using android::DisplayCaptureArgs;
@@ -30,9 +41,31 @@ using android::SurfaceComposerClient;
 using android::SyncScreenCaptureListener;
 using aidl::vendor::lineage::oplus_als::AreaCapture;
 
-static Rect screenshot_rect;
-
+/*
+ * Regions are read from vendor.sensors.als_correction.regions, a space separated list of
+ * name:left,top,right,bottom[:weight] entries, e.g. a sensor region and a guard band around it.
+ * Without it, vendor.sensors.als_correction.grabrect is used as a single region.
+ */
 AreaCapture::AreaCapture() {
+    for (const std::string& spec :
+         Split(GetProperty("vendor.sensors.als_correction.regions", ""), " ")) {
+        if (spec.empty()) {
+            continue;
+        }
+        Region region;
+        if (!parseRegion(spec, &region)) {
+            ALOGE("Invalid grab region: %s", spec.c_str());
+            continue;
+        }
+        ALOGI("Screenshot grab region %s: %d %d %d %d, weight %f", region.name.c_str(),
+              region.rect.left, region.rect.top, region.rect.right, region.rect.bottom,
+              region.weight);
+        mRegions.push_back(region);
+    }
+    if (!mRegions.empty()) {
+        return;
+    }
+
     int32_t left, top, right, bottom;
     std::istringstream is(GetProperty("vendor.sensors.als_correction.grabrect", ""));
 
@@ -43,7 +76,24 @@ AreaCapture::AreaCapture() {
     }
 
     ALOGI("Screenshot grab area: %d %d %d %d", left, top, right, bottom);
-    screenshot_rect = Rect(left, top, right, bottom);
+    mRegions.push_back({"grabrect", Rect(left, top, right, bottom), 1.0f});
+}
+
+bool AreaCapture::parseRegion(const std::string& spec, Region* region) {
+    std::vector<std::string> parts = Split(spec, ":");
+    if (parts.size() < 2 || parts.size() > 3 || parts[0].empty()) {
+        return false;
+    }
+    std::vector<std::string> coords = Split(parts[1], ",");
+    int32_t left, top, right, bottom;
+    if (coords.size() != 4 || !ParseInt(coords[0], &left, 0) || !ParseInt(coords[1], &top, 0) ||
+        !ParseInt(coords[2], &right, left + 1) || !ParseInt(coords[3], &bottom, top + 1)) {
+        return false;
+    }
+    region->name = parts[0];
+    region->rect = Rect(left, top, right, bottom);
+    region->weight = 1.0f;
+    return parts.size() == 2 || ParseFloat(parts[2], &region->weight, 0.0f);
 }
 
 // See frameworks/base/services/core/jni/com_android_server_display_DisplayControl.cpp and
@@ -54,56 +104,136 @@ sp<IBinder> AreaCapture::getInternalDisplayToken() {
     return token;
 }
 
-ndk::ScopedAStatus AreaCapture::getAreaBrightness(AreaRgbCaptureResult* _aidl_return) {
-    static sp<GraphicBuffer> outBuffer = new GraphicBuffer(screenshot_rect.getWidth(),
-        screenshot_rect.getHeight(), ::android::PIXEL_FORMAT_RGB_888,
-        GraphicBuffer::USAGE_SW_READ_OFTEN | GraphicBuffer::USAGE_SW_WRITE_OFTEN);
-
-    sp<IBinder> display = getInternalDisplayToken();
+bool AreaCapture::captureRegions(const std::vector<Region>& regions,
+                                 std::vector<AreaRgbCaptureResult>* results) {
+    Rect crop = regions[0].rect;
+    for (const Region& region : regions) {
+        crop.left = std::min(crop.left, region.rect.left);
+        crop.top = std::min(crop.top, region.rect.top);
+        crop.right = std::max(crop.right, region.rect.right);
+        crop.bottom = std::max(crop.bottom, region.rect.bottom);
+    }
 
     DisplayCaptureArgs captureArgs;
     captureArgs.displayToken = getInternalDisplayToken();
     captureArgs.pixelFormat = PixelFormat::RGBA_8888;
-    captureArgs.sourceCrop = screenshot_rect;
-    captureArgs.width = screenshot_rect.getWidth();
-    captureArgs.height = screenshot_rect.getHeight();
+    captureArgs.sourceCrop = crop;
+    captureArgs.width = crop.getWidth();
+    captureArgs.height = crop.getHeight();
     captureArgs.useIdentityTransform = true;
     captureArgs.captureSecureLayers = true;
 
     sp<SyncScreenCaptureListener> captureListener = new SyncScreenCaptureListener();
-    if (ScreenshotClient::captureDisplay(captureArgs, captureListener) != ::android::NO_ERROR) {
-        ALOGE("Capture failed");
-        return ndk::ScopedAStatus::fromServiceSpecificError(-1);
+    {
+        CaptureStats::Timer timer(mStats, CaptureStats::kCapture);
+        if (ScreenshotClient::captureDisplay(captureArgs, captureListener) != ::android::NO_ERROR) {
+            ALOGE("Capture failed");
+            return false;
+        }
+        timer.succeed();
     }
-    ScreenCaptureResults captureResults = captureListener->waitForResults();
-    if (!captureResults.fenceResult.ok()) {
-        ALOGE("Fence result error");
-        return ndk::ScopedAStatus::fromServiceSpecificError(-1);
+    ScreenCaptureResults captureResults;
+    {
+        CaptureStats::Timer timer(mStats, CaptureStats::kFenceWait);
+        captureResults = captureListener->waitForResults();
+        if (!captureResults.fenceResult.ok()) {
+            ALOGE("Fence result error");
+            return false;
+        }
+        timer.succeed();
     }
 
-    outBuffer = captureResults.buffer;
-
+    sp<GraphicBuffer> outBuffer = captureResults.buffer;
     uint8_t* out;
-    auto resultWidth = outBuffer->getWidth();
-    auto resultHeight = outBuffer->getHeight();
-    auto stride = outBuffer->getStride();
-
-    captureResults.buffer->lock(GraphicBuffer::USAGE_SW_READ_OFTEN, reinterpret_cast<void**>(&out));
-    // we can sum this directly on linear light
-    uint32_t rsum = 0, gsum = 0, bsum = 0;
-    for (int y = 0; y < resultHeight; y++) {
-        for (int x = 0; x < resultWidth; x++) {
-            rsum += out[y * (stride * 4) + x * 4];
-            gsum += out[y * (stride * 4) + x * 4 + 1];
-            bsum += out[y * (stride * 4) + x * 4 + 2];
+    int32_t resultWidth = outBuffer->getWidth();
+    int32_t resultHeight = outBuffer->getHeight();
+    int32_t stride = outBuffer->getStride();
+
+    {
+        CaptureStats::Timer timer(mStats, CaptureStats::kLock);
+        if (outBuffer->lock(GraphicBuffer::USAGE_SW_READ_OFTEN, reinterpret_cast<void**>(&out)) !=
+            ::android::NO_ERROR) {
+            ALOGE("Failed to lock capture buffer");
+            return false;
+        }
+        timer.succeed();
+    }
+    CaptureStats::Timer reduceTimer(mStats, CaptureStats::kReduce);
+
+    // Region bounds relative to the capture, clamped to the buffer.
+    struct Span {
+        int32_t left, top, right, bottom;
+        uint32_t rsum = 0, gsum = 0, bsum = 0;
+    };
+    std::vector<Span> spans;
+    for (const Region& region : regions) {
+        spans.push_back({std::clamp(region.rect.left - crop.left, 0, resultWidth),
+                         std::clamp(region.rect.top - crop.top, 0, resultHeight),
+                         std::clamp(region.rect.right - crop.left, 0, resultWidth),
+                         std::clamp(region.rect.bottom - crop.top, 0, resultHeight)});
+    }
+
+    // we can sum this directly on linear light, every row is read once for all regions
+    for (int32_t y = 0; y < resultHeight; y++) {
+        const uint8_t* row = out + y * (stride * 4);
+        for (Span& span : spans) {
+            if (y < span.top || y >= span.bottom) {
+                continue;
+            }
+            for (int32_t x = span.left; x < span.right; x++) {
+                span.rsum += row[x * 4];
+                span.gsum += row[x * 4 + 1];
+                span.bsum += row[x * 4 + 2];
+            }
         }
     }
-    float max = resultWidth * resultHeight;
-    _aidl_return->r = rsum / max;
-    _aidl_return->g = gsum / max;
-    _aidl_return->b = bsum / max;
-    
-    captureResults.buffer->unlock();
+    outBuffer->unlock();
+
+    results->clear();
+    uint64_t reducedPixels = 0;
+    for (const Span& span : spans) {
+        int32_t pixels = (span.right - span.left) * (span.bottom - span.top);
+        float max = std::max(pixels, 1);
+        results->push_back({.r = span.rsum / max, .g = span.gsum / max, .b = span.bsum / max});
+        reducedPixels += pixels;
+    }
+    reduceTimer.succeed();
+    mStats.recordBuffer(static_cast<uint64_t>(resultWidth) * resultHeight, reducedPixels,
+                        static_cast<uint64_t>(stride) * resultHeight * 4);
+    return true;
+}
+
+ndk::ScopedAStatus AreaCapture::getAreaBrightness(AreaRgbCaptureResult* _aidl_return) {
+    std::vector<AreaRgbCaptureResult> results;
+    if (mRegions.empty() || !captureRegions({mRegions[0]}, &results)) {
+        return ndk::ScopedAStatus::fromServiceSpecificError(-1);
+    }
+    *_aidl_return = results[0];
+    return ndk::ScopedAStatus::ok();
+}
 
+ndk::ScopedAStatus AreaCapture::getRegionsBrightness(
+        std::vector<AreaRegionCaptureResult>* _aidl_return) {
+    std::vector<AreaRgbCaptureResult> results;
+    if (mRegions.empty() || !captureRegions(mRegions, &results)) {
+        return ndk::ScopedAStatus::fromServiceSpecificError(-1);
+    }
+    _aidl_return->clear();
+    for (size_t i = 0; i < mRegions.size(); i++) {
+        _aidl_return->push_back(
+                {.name = mRegions[i].name, .weight = mRegions[i].weight, .rgb = results[i]});
+    }
     return ndk::ScopedAStatus::ok();
 }
+
+binder_status_t AreaCapture::dump(int fd, const char** /* args */, uint32_t /* numArgs */) {
+    std::string regions;
+    for (const Region& region : mRegions) {
+        StringAppendF(&regions, "  %s: %d %d %d %d, weight %f\n", region.name.c_str(),
+                      region.rect.left, region.rect.top, region.rect.right, region.rect.bottom,
+                      region.weight);
+    }
+    android::base::WriteStringToFd("Regions:\n" + regions, fd);
+    mStats.dump(fd);
+    return STATUS_OK;
+}
@@ -6,7 +6,13 @@
 
 #pragma once
 
+#include "CaptureStats.h"
+
 #include <aidl/vendor/lineage/oplus_als/BnAreaCapture.h>
+#include <ui/Rect.h>
+
+#include <string>
+#include <vector>
 
 namespace aidl {
 namespace vendor {
@@ -17,9 +23,29 @@ class AreaCapture : public BnAreaCapture {
   public:
     AreaCapture();
     ndk::ScopedAStatus getAreaBrightness(AreaRgbCaptureResult* _aidl_return) override;
+    ndk::ScopedAStatus getRegionsBrightness(
+            std::vector<AreaRegionCaptureResult>* _aidl_return) override;
+    binder_status_t dump(int fd, const char** args, uint32_t numArgs) override;
 
   private:
+    struct Region {
+        std::string name;
+        ::android::Rect rect;
+        float weight;
+    };
+
     static ::android::sp<::android::IBinder> getInternalDisplayToken();
+    static bool parseRegion(const std::string& spec, Region* region);
+
+    /*
+     * Capture the bounding box of the given regions in a single screenshot and average each
+     * region over it in one pass over the buffer.
+     */
+    bool captureRegions(const std::vector<Region>& regions,
+                        std::vector<AreaRgbCaptureResult>* results);
+
+    std::vector<Region> mRegions;
+    CaptureStats mStats;
 };
 
 }  // namespace oplus_als
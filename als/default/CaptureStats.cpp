@@ -0,0 +1,177 @@
+/*
+ * Copyright (C) 2024 The LineageOS Project
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "CaptureStats.h"
+
+#include <android-base/file.h>
+#include <android-base/stringprintf.h>
+
+#ifdef ALS_TRACE
+#include <cutils/trace.h>
+#endif
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstdlib>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+using android::base::StringAppendF;
+
+namespace aidl {
+namespace vendor {
+namespace lineage {
+namespace oplus_als {
+
+#define BRIGHTNESS_DIR "/sys/class/backlight/panel0-backlight/"
+
+// While the panel is on the sensors HAL captures on every light event, up to its rate limit, so
+// two panel samples further apart than this mean the screen was off in between.
+static constexpr std::chrono::seconds kMaxScreenOnGap(5);
+
+static const char* const kStageNames[CaptureStats::kStageCount] = {
+        "capture",
+        "fence wait",
+        "lock",
+        "reduce",
+};
+
+#ifdef ALS_TRACE
+static const char* const kStageCounters[CaptureStats::kStageCount] = {
+        "als.capture_us",
+        "als.fence_wait_us",
+        "als.lock_us",
+        "als.reduce_us",
+};
+#endif
+
+static int readInt(const android::base::unique_fd& fd, int def) {
+    char buf[16];
+    ssize_t len = fd < 0 ? -1 : TEMP_FAILURE_RETRY(pread(fd, buf, sizeof(buf) - 1, 0));
+    if (len <= 0) {
+        return def;
+    }
+    buf[len] = '\0';
+    return atoi(buf);
+}
+
+CaptureStats::CaptureStats()
+    : mBrightnessFd(TEMP_FAILURE_RETRY(open(BRIGHTNESS_DIR "brightness", O_RDONLY | O_CLOEXEC))),
+      mBlPowerFd(TEMP_FAILURE_RETRY(open(BRIGHTNESS_DIR "bl_power", O_RDONLY | O_CLOEXEC))) {}
+
+CaptureStats::Timer::Timer(CaptureStats& stats, Stage stage)
+    : mStats(stats), mStage(stage), mStart(std::chrono::steady_clock::now()) {}
+
+CaptureStats::Timer::~Timer() {
+    mStats.record(mStage,
+                  std::chrono::duration_cast<std::chrono::microseconds>(
+                          std::chrono::steady_clock::now() - mStart)
+                          .count(),
+                  mSucceeded);
+}
+
+void CaptureStats::record(Stage stage, int64_t us, bool succeeded) {
+#ifdef ALS_TRACE
+    atrace_int64(ATRACE_TAG_HAL, kStageCounters[stage], us);
+#endif
+    int bucket = 0;
+    while (bucket < kBucketCount - 1 && us >= (int64_t{1} << (bucket + kFirstBucketLog2))) {
+        bucket++;
+    }
+
+    bool panelOn = stage == kCapture && isPanelOn();
+    auto now = std::chrono::steady_clock::now();
+
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (stage == kCapture) {
+        updateScreenOn(panelOn, now);
+    }
+    StageStats& stats = mStages[stage];
+    stats.count++;
+    stats.failures += succeeded ? 0 : 1;
+    stats.totalUs += us;
+    stats.maxUs = std::max(stats.maxUs, us);
+    stats.buckets[bucket]++;
+}
+
+// The same test as the sensors HAL's capture gate: unblanked, with a non-zero brightness.
+bool CaptureStats::isPanelOn() const {
+    // FB_BLANK_UNBLANK is 0, anything else means the panel is powered down.
+    return readInt(mBlPowerFd, 0) == 0 && readInt(mBrightnessFd, 0) != 0;
+}
+
+void CaptureStats::updateScreenOn(bool panelOn, std::chrono::steady_clock::time_point now) {
+    if (mPanelOn && panelOn && now - mLastPanelSample <= kMaxScreenOnGap) {
+        mScreenOnTime += now - mLastPanelSample;
+    }
+    mPanelOn = panelOn;
+    mLastPanelSample = now;
+}
+
+void CaptureStats::recordBuffer(uint64_t pixels, uint64_t reducedPixels, uint64_t bufferBytes) {
+#ifdef ALS_TRACE
+    atrace_int64(ATRACE_TAG_HAL, "als.pixels", pixels);
+    atrace_int64(ATRACE_TAG_HAL, "als.buffer_bytes", bufferBytes);
+#endif
+    std::lock_guard<std::mutex> lock(mMutex);
+    mBuffers++;
+    mPixels += pixels;
+    mReducedPixels += reducedPixels;
+    mBufferBytes += bufferBytes;
+    mMaxBufferBytes = std::max(mMaxBufferBytes, bufferBytes);
+}
+
+void CaptureStats::dump(int fd) {
+    std::string out;
+    bool panelOn = isPanelOn();
+    auto now = std::chrono::steady_clock::now();
+    std::lock_guard<std::mutex> lock(mMutex);
+    updateScreenOn(panelOn, now);
+    int64_t uptimeS = std::chrono::duration_cast<std::chrono::seconds>(now - mStart).count();
+    int64_t screenOnS = std::chrono::duration_cast<std::chrono::seconds>(mScreenOnTime).count();
+    StringAppendF(&out,
+                  "Captures over %" PRId64 " s, %" PRId64 " s with the screen on: %" PRIu64 "\n",
+                  uptimeS, screenOnS, mStages[kCapture].count);
+
+    int64_t totalUs = 0;
+    for (int stage = 0; stage < kStageCount; stage++) {
+        const StageStats& stats = mStages[stage];
+        totalUs += stats.totalUs;
+        StringAppendF(&out,
+                      "  %-10s: %" PRIu64 " runs, %" PRIu64 " failed, avg %" PRId64
+                      " us, max %" PRId64 " us\n",
+                      kStageNames[stage], stats.count, stats.failures,
+                      stats.count > 0 ? stats.totalUs / static_cast<int64_t>(stats.count) : 0,
+                      stats.maxUs);
+        out += "   ";
+        for (int bucket = 0; bucket < kBucketCount; bucket++) {
+            if (bucket < kBucketCount - 1) {
+                StringAppendF(&out, " <%dus:%" PRIu64, 1 << (bucket + kFirstBucketLog2),
+                              stats.buckets[bucket]);
+            } else {
+                StringAppendF(&out, " more:%" PRIu64 "\n", stats.buckets[bucket]);
+            }
+        }
+    }
+    StringAppendF(&out, "  Time spent: %" PRId64 " ms in total", totalUs / 1000);
+    if (screenOnS > 0) {
+        StringAppendF(&out, ", %" PRId64 " ms per hour of screen on time",
+                      totalUs * 3600 / screenOnS / 1000);
+    }
+    out += "\n";
+
+    StringAppendF(&out,
+                  "  Buffers: %" PRIu64 ", pixels captured %" PRIu64 ", reduced %" PRIu64
+                  ", bytes mapped %" PRIu64 ", largest buffer %" PRIu64 " bytes\n",
+                  mBuffers, mPixels, mReducedPixels, mBufferBytes, mMaxBufferBytes);
+    android::base::WriteStringToFd(out, fd);
+}
+
+}  // namespace oplus_als
+}  // namespace lineage
+}  // namespace vendor
+}  // namespace aidl
@@ -0,0 +1,102 @@
+/*
+ * Copyright (C) 2024 The LineageOS Project
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <android-base/unique_fd.h>
+
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+
+namespace aidl {
+namespace vendor {
+namespace lineage {
+namespace oplus_als {
+
+/**
+ * Cost of the captures served by AreaCapture, reported through dumpsys. Every capture goes
+ * through the stages below, each timed into a log2 histogram of microseconds. When built with
+ * ALS_TRACE, which Android.bp does for debuggable builds, the stage times and pixel counts are
+ * also emitted as atrace counters under the "hal" category. The cost is put against the time the
+ * screen was on, as the sensors HAL only asks for captures then.
+ */
+class CaptureStats {
+  public:
+    enum Stage {
+        kCapture,    // asking SurfaceFlinger to compose the capture
+        kFenceWait,  // waiting for the capture buffer
+        kLock,       // mapping the buffer for CPU reads
+        kReduce,     // averaging the regions
+        kStageCount,
+    };
+
+    //! Times one stage, recorded as a failure unless succeed() is called.
+    class Timer {
+      public:
+        Timer(CaptureStats& stats, Stage stage);
+        ~Timer();
+        void succeed() { mSucceeded = true; }
+
+      private:
+        CaptureStats& mStats;
+        Stage mStage;
+        std::chrono::steady_clock::time_point mStart;
+        bool mSucceeded = false;
+    };
+
+    CaptureStats();
+
+    /**
+     * Record the buffer a capture produced.
+     *
+     * @param pixels The pixels of the captured bounding box.
+     * @param reducedPixels The pixels averaged, overlapping regions counting once per region.
+     * @param bufferBytes The size of the buffer including its stride.
+     */
+    void recordBuffer(uint64_t pixels, uint64_t reducedPixels, uint64_t bufferBytes);
+
+    void dump(int fd);
+
+  private:
+    // Bucket i counts durations below 2^(i + kFirstBucketLog2) us, the last one the rest.
+    static constexpr int kFirstBucketLog2 = 5;
+    static constexpr int kBucketCount = 12;
+
+    struct StageStats {
+        uint64_t count = 0;
+        uint64_t failures = 0;
+        int64_t totalUs = 0;
+        int64_t maxUs = 0;
+        uint64_t buckets[kBucketCount] = {};
+    };
+
+    void record(Stage stage, int64_t us, bool succeeded);
+    bool isPanelOn() const;
+    // Called with mMutex held.
+    void updateScreenOn(bool panelOn, std::chrono::steady_clock::time_point now);
+
+    ::android::base::unique_fd mBrightnessFd;
+    ::android::base::unique_fd mBlPowerFd;
+
+    std::mutex mMutex;
+    StageStats mStages[kStageCount];
+    uint64_t mBuffers = 0;
+    uint64_t mPixels = 0;
+    uint64_t mReducedPixels = 0;
+    uint64_t mBufferBytes = 0;
+    uint64_t mMaxBufferBytes = 0;
+    std::chrono::steady_clock::time_point mStart = std::chrono::steady_clock::now();
+    std::chrono::steady_clock::time_point mLastPanelSample = mStart;
+    bool mPanelOn = false;
+    std::chrono::steady_clock::duration mScreenOnTime{};
+};
+
+}  // namespace oplus_als
+}  // namespace lineage
+}  // namespace vendor
+}  // namespace aidl
@@ -6,6 +6,9 @@ LOCAL_MODULE_TAGS := optional
 
 LOCAL_SRC_FILES := $(call all-java-files-under, src)
 
+LOCAL_STATIC_JAVA_LIBRARIES := vendor.lineage.oplus_motor-V1-java
+LOCAL_REQUIRED_MODULES := vendor.lineage.oplus_motor.service
+
 LOCAL_PACKAGE_NAME := OnePlusCameraHelper
 LOCAL_CERTIFICATE := platform
 LOCAL_PRIVATE_PLATFORM_APIS := true
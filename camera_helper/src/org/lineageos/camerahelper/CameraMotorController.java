@@ -7,12 +7,18 @@
 package org.lineageos.camerahelper;
 
 import android.os.FileUtils;
+import android.os.IBinder;
+import android.os.RemoteException;
+import android.os.ServiceManager;
+import android.os.ServiceSpecificException;
 import android.text.TextUtils;
 import android.util.Log;
 
 import java.io.File;
 import java.io.IOException;
 
+import vendor.lineage.oplus_motor.ICameraMotor;
+
 public class CameraMotorController {
     private static final String TAG = "CameraMotorController";
 
@@ -41,6 +47,11 @@ public class CameraMotorController {
     public static final String POSITION_DOWN = "1";
     public static final String POSITION_UP = "0";
 
+    // Native motor service, keeping the motor nodes open and tracking the motor state
+    private static final String CAMERA_MOTOR_SERVICE = ICameraMotor.DESCRIPTOR + "/default";
+
+    private static ICameraMotor sCameraMotor;
+
     private CameraMotorController() {
         // This class is not supposed to be instantiated
     }
@@ -62,7 +73,35 @@ public class CameraMotorController {
         }
     }
 
-    public static void setMotorDirection(String direction) {
+    public static synchronized void moveMotor(String direction) {
+        ICameraMotor cameraMotor = getCameraMotor();
+        if (cameraMotor != null) {
+            try {
+                cameraMotor.move(DIRECTION_UP.equals(direction));
+                return;
+            } catch (RemoteException | ServiceSpecificException e) {
+                Log.e(TAG, "Failed to move the camera through " + CAMERA_MOTOR_SERVICE, e);
+                sCameraMotor = null;
+            }
+        }
+
+        setMotorDirection(direction);
+        setMotorEnabled();
+    }
+
+    // Callers run on main loopers, so only pick the service up once it is registered rather than
+    // waiting for it, and drive the sysfs nodes directly until then.
+    private static ICameraMotor getCameraMotor() {
+        if (sCameraMotor == null) {
+            IBinder binder = ServiceManager.checkService(CAMERA_MOTOR_SERVICE);
+            if (binder != null) {
+                sCameraMotor = ICameraMotor.Stub.asInterface(binder);
+            }
+        }
+        return sCameraMotor;
+    }
+
+    private static void setMotorDirection(String direction) {
         try {
             FileUtils.stringToFile(CAMERA_MOTOR_DIRECTION_PATH, direction);
         } catch (IOException e) {
@@ -70,7 +109,7 @@ public class CameraMotorController {
         }
     }
 
-    public static void setMotorEnabled() {
+    private static void setMotorEnabled() {
         try {
             FileUtils.stringToFile(CAMERA_MOTOR_ENABLE_PATH, ENABLED);
         } catch (IOException e) {
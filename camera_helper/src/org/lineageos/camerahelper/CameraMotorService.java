@@ -94,12 +94,10 @@ public class CameraMotorService extends Service implements Handler.Callback {
     public boolean handleMessage(Message msg) {
         switch (msg.what) {
             case MSG_CAMERA_CLOSED:
-                CameraMotorController.setMotorDirection(CameraMotorController.DIRECTION_DOWN);
-                CameraMotorController.setMotorEnabled();
+                CameraMotorController.moveMotor(CameraMotorController.DIRECTION_DOWN);
                 break;
             case MSG_CAMERA_OPEN:
-                CameraMotorController.setMotorDirection(CameraMotorController.DIRECTION_UP);
-                CameraMotorController.setMotorEnabled();
+                CameraMotorController.moveMotor(CameraMotorController.DIRECTION_UP);
                 break;
         }
         return true;
@@ -26,6 +26,9 @@ public class FallSensor implements SensorEventListener {
     private static final boolean DEBUG = true;
     private static final String TAG = "FallSensor";
 
+    // Set in values[1] when the sensors HAL already retracted the camera, see CameraProtect.h
+    private static final float RETRACTED_BY_HAL = 1.0f;
+
     private ExecutorService mExecutorService;
     private SensorManager mSensorManager;
     private Sensor mSensor;
@@ -52,6 +55,12 @@ public class FallSensor implements SensorEventListener {
             return;
         }
 
+        if (event.values.length > 1 && event.values[1] == RETRACTED_BY_HAL) {
+            Log.d(TAG, "Fall detected, front camera already closed by the sensors HAL");
+            showFallDialog();
+            return;
+        }
+
         Log.d(TAG, "Fall detected, ensuring front camera is closed");
 
         // We shouldn't really bother doing anything if motor is already closed
@@ -60,9 +69,12 @@ public class FallSensor implements SensorEventListener {
         }
 
         // Close the camera
-        CameraMotorController.setMotorDirection(CameraMotorController.DIRECTION_DOWN);
-        CameraMotorController.setMotorEnabled();
+        CameraMotorController.moveMotor(CameraMotorController.DIRECTION_DOWN);
+
+        showFallDialog();
+    }
 
+    private void showFallDialog() {
         // Show alert dialog informing user that we closed the camera
         new Handler(Looper.getMainLooper()).post(() -> {
             AlertDialog alertDialog = new AlertDialog.Builder(mContext)
@@ -70,8 +82,7 @@ public class FallSensor implements SensorEventListener {
                     .setMessage(R.string.free_fall_detected_message)
                     .setNegativeButton(R.string.raise_the_camera, (dialog, which) -> {
                         // Reopen the camera
-                        CameraMotorController.setMotorDirection(CameraMotorController.DIRECTION_UP);
-                        CameraMotorController.setMotorEnabled();
+                        CameraMotorController.moveMotor(CameraMotorController.DIRECTION_UP);
                     })
                     .setPositiveButton(R.string.close, (dialog, which) -> {
                         // Go back to home screen
@@ -81,9 +81,7 @@ public class KeyHandler implements DeviceKeyHandler {
                         .setMessage(R.string.motor_cannot_go_down_message)
                         .setPositiveButton(R.string.retry, (dialog, which) -> {
                             // Close the camera
-                            CameraMotorController.setMotorDirection(
-                                    CameraMotorController.DIRECTION_DOWN);
-                            CameraMotorController.setMotorEnabled();
+                            CameraMotorController.moveMotor(CameraMotorController.DIRECTION_DOWN);
                         })
                         .create();
                 alertDialog.getWindow().setType(WindowManager.LayoutParams.TYPE_SYSTEM_ALERT);
@@ -103,15 +101,11 @@ public class KeyHandler implements DeviceKeyHandler {
                         .setMessage(R.string.motor_cannot_go_up_message)
                         .setNegativeButton(R.string.retry, (dialog, which) -> {
                             // Reopen the camera
-                            CameraMotorController.setMotorDirection(
-                                    CameraMotorController.DIRECTION_UP);
-                            CameraMotorController.setMotorEnabled();
+                            CameraMotorController.moveMotor(CameraMotorController.DIRECTION_UP);
                         })
                         .setPositiveButton(R.string.close, (dialog, which) -> {
                             // Close the camera
-                            CameraMotorController.setMotorDirection(
-                                    CameraMotorController.DIRECTION_DOWN);
-                            CameraMotorController.setMotorEnabled();
+                            CameraMotorController.moveMotor(CameraMotorController.DIRECTION_DOWN);
 
                             // Go back to home screen
                             Intent intent = new Intent(Intent.ACTION_MAIN);
@@ -221,17 +221,15 @@ PRODUCT_PACKAGES += \
 
 # Init
 PRODUCT_PACKAGES += \
-    init.class_main.sh \
     init.oplus.rc \
-    init.oplus.sh \
-    init.qcom.early_boot.sh \
     init.qcom.rc \
     init.qcom.recovery.rc \
-    init.qcom.sh \
     init.qcom.usb.rc \
     init.qcom.usb.sh \
     init.target.power.rc \
     init.target.rc \
+    init_helper.oneplus_msmnile \
+    init_tune.oneplus_msmnile \
     ueventd.qcom.rc
 
 # Input
@@ -322,10 +320,8 @@ $(call inherit-product, hardware/oplus/libqti-perfd-client/libqti-perfd-client.m
 $(call inherit-product, hardware/oplus/power-libperfmgr/power-libperfmgr.mk)
 
 PRODUCT_PACKAGES += \
-    android.hardware.power@1.2.vendor
-
-PRODUCT_COPY_FILES += \
-    $(LOCAL_PATH)/configs/powerhint.json:$(TARGET_COPY_OUT_VENDOR)/etc/powerhint.json
+    android.hardware.power@1.2.vendor \
+    powerhint.json.oneplus_msmnile
 
 # QMI
 PRODUCT_PACKAGES += \
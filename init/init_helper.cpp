@@ -0,0 +1,252 @@
+/*
+ * Copyright (C) 2024 The LineageOS Project
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * Boot time steps that used to be vendor shell scripts, done without forking a shell and its
+ * cat/grep/getprop/setprop children:
+ *
+ *   early-boot    init.qcom.early_boot.sh and init.oplus.sh
+ *   class-main    init.class_main.sh
+ *   modem-config  init.qcom.sh
+ */
+
+#define LOG_TAG "init_helper"
+
+#include <android-base/file.h>
+#include <android-base/logging.h>
+#include <android-base/properties.h>
+#include <android-base/strings.h>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <chrono>
+#include <functional>
+#include <map>
+#include <memory>
+#include <set>
+
+using android::base::GetProperty;
+using android::base::ReadFileToString;
+using android::base::SetProperty;
+using android::base::WriteStringToFile;
+
+namespace {
+
+// Run a step and log how long it took.
+bool timed(const char* name, const std::function<bool()>& step) {
+    auto start = std::chrono::steady_clock::now();
+    bool ok = step();
+    auto us = std::chrono::duration_cast<std::chrono::microseconds>(
+                      std::chrono::steady_clock::now() - start)
+                      .count();
+    LOG(INFO) << name << (ok ? " done" : " failed") << " in " << us << " us";
+    return ok;
+}
+
+bool setProperty(const std::string& name, const std::string& value) {
+    if (!SetProperty(name, value)) {
+        LOG(ERROR) << "Failed to set " << name << " to " << value;
+        return false;
+    }
+    return true;
+}
+
+// androidboot.* arguments from the kernel command line.
+std::map<std::string, std::string> readBootArgs() {
+    std::map<std::string, std::string> args;
+    std::string cmdline;
+    if (!ReadFileToString("/proc/cmdline", &cmdline)) {
+        PLOG(ERROR) << "Failed to read /proc/cmdline";
+        return args;
+    }
+    for (const std::string& arg : android::base::Split(android::base::Trim(cmdline), " ")) {
+        size_t eq = arg.find('=');
+        if (eq != std::string::npos && android::base::StartsWith(arg, "androidboot.")) {
+            args[arg.substr(0, eq)] = arg.substr(eq + 1);
+        }
+    }
+    return args;
+}
+
+int earlyBoot() {
+    bool ok = timed("drm vblankoffdelay", [] {
+        // For drm based display driver
+        return WriteStringToFile("-1", "/sys/module/drm/parameters/vblankoffdelay");
+    });
+
+    ok &= timed("alarm boot", [] {
+        std::string bootReason;
+        ReadFileToString("/proc/sys/kernel/boot_reason", &bootReason);
+        bool alarmBoot = android::base::Trim(bootReason) == "3" ||
+                         GetProperty("ro.boot.alarmboot", "") == "true";
+        return setProperty("ro.vendor.alarm_boot", alarmBoot ? "true" : "false");
+    });
+
+    ok &= timed("multisim config", [] {
+        // 18821 - 7 Pro
+        // 18831 - 7 Pro TMO
+        // 18857 - 7
+        // 18865 - 7T
+        // 19801 - 7T Pro
+        // 19863 - 7T TMO
+        static const std::set<std::string> kDsdsProjects = {"18821", "18857", "18865", "19801"};
+        auto args = readBootArgs();
+        auto project = args.find("androidboot.prj_version");
+        if (project == args.end() || !kDsdsProjects.count(project->second)) {
+            return true;
+        }
+        return setProperty("vendor.radio.multisim.config", "dsds");
+    });
+
+    return ok ? 0 : 1;
+}
+
+int classMain() {
+    bool ok = true;
+    for (const char* service : {"vendor.qcrild", "vendor.qcrild2", "vendor.dataqti"}) {
+        ok &= setProperty("ctl.start", service);
+    }
+    return ok ? 0 : 1;
+}
+
+constexpr const char* kModemConfigDir = "/data/vendor/modem_config";
+constexpr const char* kFirmwareVerInfo = "/vendor/firmware_mnt/verinfo/ver_info.txt";
+constexpr const char* kFirmwareMcfgDir = "/vendor/firmware_mnt/image/modem_pr/mcfg/configs";
+constexpr const char* kFirmwareMbnOta = "/vendor/firmware_mnt/image/modem_pr/mbn_ota.txt";
+
+// Remove everything below path, but not path itself.
+bool removeContents(const std::string& path) {
+    std::unique_ptr<DIR, decltype(&closedir)> dir(opendir(path.c_str()), closedir);
+    if (!dir) {
+        return errno == ENOENT;
+    }
+    // Add group write first, root is not granted DAC override here.
+    struct stat st;
+    if (stat(path.c_str(), &st) == 0) {
+        chmod(path.c_str(), (st.st_mode | S_IWGRP) & 07777);
+    }
+    bool ok = true;
+    while (dirent* entry = readdir(dir.get())) {
+        std::string name = entry->d_name;
+        if (name == "." || name == "..") continue;
+        std::string child = path + "/" + name;
+        if (entry->d_type == DT_DIR) {
+            ok &= removeContents(child) && rmdir(child.c_str()) == 0;
+        } else if (unlink(child.c_str()) != 0) {
+            PLOG(ERROR) << "Failed to remove " << child;
+            ok = false;
+        }
+    }
+    return ok;
+}
+
+/*
+ * Copy from to to, keeping modes and symlinks and chowning the copies to radio:root. This is
+ * what cp --preserve=m -d[r] followed by chown -hR radio.root did.
+ */
+bool copyTree(const std::string& from, const std::string& to, bool recursive) {
+    struct stat st;
+    if (lstat(from.c_str(), &st) != 0) {
+        PLOG(ERROR) << "Failed to stat " << from;
+        return false;
+    }
+    static const uid_t kRadioUid = 1001;
+    bool ok = true;
+    if (S_ISLNK(st.st_mode)) {
+        std::string target;
+        ok = android::base::Readlink(from, &target) && symlink(target.c_str(), to.c_str()) == 0;
+    } else if (S_ISDIR(st.st_mode)) {
+        if (!recursive) return false;
+        // The source is often read-only (the firmware_mnt dmask), and root is not granted DAC
+        // override here. Keep the directory writable until its children are in, the final mode
+        // is set below, as cp --preserve=m does.
+        ok = mkdir(to.c_str(), (st.st_mode & 07777) | S_IRWXU) == 0;
+        std::unique_ptr<DIR, decltype(&closedir)> dir(opendir(from.c_str()), closedir);
+        while (ok && dir) {
+            dirent* entry = readdir(dir.get());
+            if (!entry) break;
+            std::string name = entry->d_name;
+            if (name == "." || name == "..") continue;
+            ok = copyTree(from + "/" + name, to + "/" + name, recursive);
+        }
+        ok = ok && dir;
+    } else {
+        std::string contents;
+        ok = ReadFileToString(from, &contents) && WriteStringToFile(contents, to);
+    }
+    if (!ok) {
+        PLOG(ERROR) << "Failed to copy " << from << " to " << to;
+        return false;
+    }
+    // The group must be root, so that the next update can add group write before deleting.
+    if (lchown(to.c_str(), kRadioUid, 0) != 0 ||
+        (!S_ISLNK(st.st_mode) && chmod(to.c_str(), st.st_mode & 07777) != 0)) {
+        PLOG(ERROR) << "Failed to set owner and mode of " << to;
+        return false;
+    }
+    return true;
+}
+
+int modemConfig() {
+    bool ok = timed("modem config", [] {
+        // Make modem config folder and copy firmware config to that folder for RIL
+        std::string previous, current;
+        ReadFileToString(std::string(kModemConfigDir) + "/ver_info.txt", &previous);
+        if (ReadFileToString(kFirmwareVerInfo, &current) && previous == current) {
+            return true;
+        }
+
+        LOG(INFO) << "Modem firmware changed, refreshing " << kModemConfigDir;
+        if (!removeContents(kModemConfigDir)) {
+            return false;
+        }
+        bool copied = true;
+        std::unique_ptr<DIR, decltype(&closedir)> dir(opendir(kFirmwareMcfgDir), closedir);
+        while (dir) {
+            dirent* entry = readdir(dir.get());
+            if (!entry) break;
+            std::string name = entry->d_name;
+            if (name == "." || name == "..") continue;
+            copied &= copyTree(std::string(kFirmwareMcfgDir) + "/" + name,
+                               std::string(kModemConfigDir) + "/" + name, true);
+        }
+        copied &= copyTree(kFirmwareVerInfo, std::string(kModemConfigDir) + "/ver_info.txt",
+                           false);
+        copied &= copyTree(kFirmwareMbnOta, std::string(kModemConfigDir) + "/mbn_ota.txt",
+                           false);
+        return copied;
+    });
+
+    struct stat st;
+    if (stat(kModemConfigDir, &st) == 0) {
+        chmod(kModemConfigDir, st.st_mode & ~S_IWGRP & 07777);
+    }
+    // Set even if the copy failed, as the script did, so that RIL does not wait forever.
+    ok &= setProperty("ro.vendor.ril.mbn_copy_completed", "1");
+    return ok ? 0 : 1;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    android::base::InitLogging(argv);
+
+    static const std::map<std::string, std::function<int()>> kCommands = {
+            {"early-boot", earlyBoot},
+            {"class-main", classMain},
+            {"modem-config", modemConfig},
+    };
+    auto command = argc == 2 ? kCommands.find(argv[1]) : kCommands.end();
+    if (command == kCommands.end()) {
+        LOG(ERROR) << "Usage: " << argv[0] << " early-boot|class-main|modem-config";
+        return 1;
+    }
+    return timed(argv[1], [&] { return command->second() == 0; }) ? 0 : 1;
+}
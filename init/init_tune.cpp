@@ -0,0 +1,293 @@
+/*
+ * Copyright (C) 2024 The LineageOS Project
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * Applies one stage of init_tune.conf, the sysfs and procfs tunables that used to be runs of
+ * write commands in init.target.rc and init.target.power.rc.
+ *
+ * Usage: init_tune [--config <file>] <stage>
+ *
+ * The config is split into stages by [stage] lines. Within a stage, entries are
+ * "<path> <value>" lines, and blank lines separate groups. Entries of a group are applied in
+ * order, e.g. a devfreq governor before its tunables, while different groups are independent
+ * and applied in parallel. ${property} in a path or value is replaced like init does, and '#'
+ * starts a comment line.
+ *
+ * Every node is read first and left alone if it already holds the value, is read back after
+ * writing and reported with how long it took. The kernel log gets a summary and the tunables
+ * that fail or do not take on a given device, logd the full per-node report.
+ */
+
+#define LOG_TAG "init_tune"
+
+#include <android-base/file.h>
+#include <android-base/logging.h>
+#include <android-base/properties.h>
+#include <android-base/strings.h>
+#include <android-base/unique_fd.h>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+using android::base::ReadFileToString;
+using android::base::unique_fd;
+
+namespace {
+
+constexpr const char* kDefaultConfig = "/vendor/etc/init_tune.conf";
+constexpr size_t kMaxThreads = 4;
+
+struct Entry {
+    std::string path;
+    std::string value;
+};
+
+enum class Result {
+    kUnchanged,   // already held the value
+    kWritten,     // written and read back
+    kUnverified,  // written, but the node cannot be read
+    kMismatch,    // written, but reads back something else
+    kFailed,      // could not be written
+};
+
+const char* resultName(Result result) {
+    switch (result) {
+        case Result::kUnchanged:
+            return "unchanged";
+        case Result::kWritten:
+            return "written";
+        case Result::kUnverified:
+            return "written, unverified";
+        case Result::kMismatch:
+            return "MISMATCH";
+        case Result::kFailed:
+            return "FAILED";
+    }
+    return "?";
+}
+
+struct Report {
+    Result result;
+    std::string detail;
+    int64_t us;
+};
+
+// Replace ${name} with the value of the property, false if one is unset.
+bool expandProperties(const std::string& in, std::string* out) {
+    out->clear();
+    size_t pos = 0;
+    while (true) {
+        size_t start = in.find("${", pos);
+        if (start == std::string::npos) {
+            out->append(in, pos);
+            return true;
+        }
+        size_t end = in.find('}', start);
+        if (end == std::string::npos) {
+            return false;
+        }
+        std::string value = android::base::GetProperty(in.substr(start + 2, end - start - 2), "");
+        if (value.empty()) {
+            return false;
+        }
+        out->append(in, pos, start - pos).append(value);
+        pos = end + 1;
+    }
+}
+
+/*
+ * Whether a node reading back current holds value. Besides plain values this covers selector
+ * nodes such as queue/scheduler and mem_sleep, which list every choice and mark the active one
+ * as "[value]", and lists the kernel prints with different spacing.
+ */
+bool holds(const std::string& current, const std::string& value) {
+    auto normalize = [](const std::string& s) {
+        std::vector<std::string> words;
+        for (const std::string& word : android::base::Split(android::base::Trim(s), " \t\n")) {
+            if (!word.empty()) words.push_back(word);
+        }
+        return android::base::Join(words, ' ');
+    };
+    std::string normalized = normalize(current);
+    return normalized == normalize(value) ||
+           normalized.find("[" + value + "]") != std::string::npos;
+}
+
+Report apply(const Entry& entry) {
+    auto start = std::chrono::steady_clock::now();
+    Report report = {Result::kFailed, "", 0};
+
+    std::string path, value, current;
+    if (!expandProperties(entry.path, &path) || !expandProperties(entry.value, &value)) {
+        report.detail = "unset property";
+    } else if (ReadFileToString(path, &current) && holds(current, value)) {
+        report.result = Result::kUnchanged;
+    } else {
+        unique_fd fd(TEMP_FAILURE_RETRY(open(path.c_str(), O_WRONLY | O_CLOEXEC)));
+        if (fd < 0 || TEMP_FAILURE_RETRY(write(fd, value.c_str(), value.size())) !=
+                              static_cast<ssize_t>(value.size())) {
+            report.detail = strerror(errno);
+        } else if (!ReadFileToString(path, &current)) {
+            report.result = Result::kUnverified;
+        } else if (!holds(current, value)) {
+            report.result = Result::kMismatch;
+            report.detail = "reads " + android::base::Trim(current);
+        } else {
+            report.result = Result::kWritten;
+        }
+    }
+
+    report.us = std::chrono::duration_cast<std::chrono::microseconds>(
+                        std::chrono::steady_clock::now() - start)
+                        .count();
+    return report;
+}
+
+// The groups of one stage, false if the config cannot be parsed or lacks the stage.
+bool loadStage(const std::string& config, const std::string& stage,
+               std::vector<std::vector<Entry>>* groups) {
+    std::string text;
+    if (!ReadFileToString(config, &text)) {
+        PLOG(ERROR) << "Failed to read " << config;
+        return false;
+    }
+
+    bool found = false, inStage = false, newGroup = true;
+    std::vector<std::string> lines = android::base::Split(text, "\n");
+    for (size_t i = 0; i < lines.size(); i++) {
+        std::string line = android::base::Trim(lines[i]);
+        if (line.empty()) {
+            newGroup = true;
+            continue;
+        }
+        if (line[0] == '#') {
+            continue;
+        }
+        if (line.front() == '[' && line.back() == ']') {
+            inStage = line.substr(1, line.size() - 2) == stage;
+            found |= inStage;
+            newGroup = true;
+            continue;
+        }
+        if (!inStage) {
+            continue;
+        }
+
+        size_t split = line.find_first_of(" \t");
+        if (split == std::string::npos) {
+            LOG(ERROR) << config << ":" << i + 1 << ": expected <path> <value>";
+            return false;
+        }
+        Entry entry = {line.substr(0, split), android::base::Trim(line.substr(split))};
+        if (entry.value.size() >= 2 && entry.value.front() == '"' && entry.value.back() == '"') {
+            entry.value = entry.value.substr(1, entry.value.size() - 2);
+        }
+        if (newGroup) {
+            groups->emplace_back();
+            newGroup = false;
+        }
+        groups->back().push_back(std::move(entry));
+    }
+
+    if (!found) {
+        LOG(ERROR) << config << " has no stage " << stage;
+    }
+    return found;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    android::base::InitLogging(argv, &android::base::KernelLogger);
+
+    std::string config = kDefaultConfig;
+    int arg = 1;
+    if (argc > 2 && !strcmp(argv[1], "--config")) {
+        config = argv[2];
+        arg = 3;
+    }
+    if (argc - arg != 1) {
+        LOG(ERROR) << "Usage: " << argv[0] << " [--config <file>] <stage>";
+        return 1;
+    }
+    std::string stage = argv[arg];
+
+    std::vector<std::vector<Entry>> groups;
+    if (!loadStage(config, stage, &groups)) {
+        return 1;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::vector<Report>> reports(groups.size());
+    std::atomic<size_t> next = 0;
+    auto worker = [&] {
+        for (size_t group; (group = next++) < groups.size();) {
+            for (const Entry& entry : groups[group]) {
+                reports[group].push_back(apply(entry));
+            }
+        }
+    };
+    std::vector<std::thread> threads;
+    size_t threadCount = std::min<size_t>(
+            {groups.size(), kMaxThreads, std::max(1u, std::thread::hardware_concurrency())});
+    for (size_t i = 1; i < threadCount; i++) {
+        threads.emplace_back(worker);
+    }
+    worker();
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    auto wallUs = std::chrono::duration_cast<std::chrono::microseconds>(
+                          std::chrono::steady_clock::now() - start)
+                          .count();
+
+    // kmsg rate limits userspace and would drop most of a per-node report, so the kernel log
+    // only gets the summary, first, and the entries that need attention. The full report goes
+    // to logd, once it is up.
+    android::base::LogdLogger logdLogger;
+    size_t counts[5] = {};
+    int64_t totalUs = 0;
+    std::vector<std::string> problems;
+    for (size_t group = 0; group < groups.size(); group++) {
+        for (size_t i = 0; i < groups[group].size(); i++) {
+            const Entry& entry = groups[group][i];
+            const Report& report = reports[group][i];
+            counts[static_cast<size_t>(report.result)]++;
+            totalUs += report.us;
+            std::string line = stage + ": " + entry.path + " " + entry.value + ": " +
+                               resultName(report.result) +
+                               (report.detail.empty() ? "" : " (" + report.detail + ")") + ", " +
+                               std::to_string(report.us) + " us";
+            bool bad = report.result == Result::kFailed || report.result == Result::kMismatch;
+            logdLogger(android::base::DEFAULT, bad ? android::base::WARNING : android::base::INFO,
+                       LOG_TAG, __FILE__, __LINE__, line.c_str());
+            if (bad) {
+                problems.push_back(std::move(line));
+            }
+        }
+    }
+    LOG(INFO) << stage << ": " << groups.size() << " groups in " << wallUs << " us ("
+              << totalUs << " us of node time on " << threadCount << " threads): "
+              << counts[static_cast<size_t>(Result::kWritten)] << " written, "
+              << counts[static_cast<size_t>(Result::kUnchanged)] << " unchanged, "
+              << counts[static_cast<size_t>(Result::kUnverified)] << " unverified, "
+              << counts[static_cast<size_t>(Result::kMismatch)] << " mismatched, "
+              << counts[static_cast<size_t>(Result::kFailed)] << " failed";
+    for (const std::string& line : problems) {
+        LOG(WARNING) << line;
+    }
+
+    // Failed tunables are reported above, they must not hold up the boot stage.
+    return 0;
+}
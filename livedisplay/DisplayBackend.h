@@ -0,0 +1,44 @@
+/*
+ * Copyright (C) 2024 The LineageOS Project
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef VENDOR_LINEAGE_LIVEDISPLAY_V2_1_DISPLAYBACKEND_H
+#define VENDOR_LINEAGE_LIVEDISPLAY_V2_1_DISPLAYBACKEND_H
+
+#include <cstdint>
+
+namespace vendor {
+namespace lineage {
+namespace livedisplay {
+namespace V2_1 {
+namespace implementation {
+
+/*
+ * The hardware DisplayModeEngine drives. On device these go to SDM and /dev/oplus_display,
+ * the host benchmark replaces them with in-memory fakes.
+ */
+class DisplayController {
+  public:
+    virtual ~DisplayController() = default;
+
+    // Both return 0 on success, like SDMController.
+    virtual int32_t setActiveDisplayMode(int32_t displayModeId) = 0;
+    virtual int32_t setDefaultDisplayMode(int32_t displayModeId) = 0;
+};
+
+class PanelDevice {
+  public:
+    virtual ~PanelDevice() = default;
+
+    virtual bool setSeedMode(uint32_t seedMode) = 0;
+};
+
+}  // namespace implementation
+}  // namespace V2_1
+}  // namespace livedisplay
+}  // namespace lineage
+}  // namespace vendor
+
+#endif  // VENDOR_LINEAGE_LIVEDISPLAY_V2_1_DISPLAYBACKEND_H
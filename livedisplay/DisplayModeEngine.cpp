@@ -0,0 +1,295 @@
+/*
+ * Copyright (C) 2019-2024 The LineageOS Project
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#define LOG_TAG "DisplayModesService"
+
+#include "DisplayModeEngine.h"
+
+#include <android-base/file.h>
+#include <android-base/logging.h>
+#include <android-base/unique_fd.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <utility>
+
+using android::base::unique_fd;
+using android::base::WriteStringToFd;
+
+namespace vendor {
+namespace lineage {
+namespace livedisplay {
+namespace V2_1 {
+namespace implementation {
+
+// Mode ids here must match qdcm display mode ids
+const std::map<int32_t, DisplayModeEngine::ModeInfo> DisplayModeEngine::kModeMap = {
+        {0, {"Vivid", 0, 0}},
+        {1, {"Natural", 1, 1}},
+        {2, {"Cinematic", 0, 1}},
+        {3, {"Brilliant", 4, 0}},
+};
+
+DisplayModeEngine::DisplayModeEngine(std::shared_ptr<DisplayController> controller,
+                                     std::shared_ptr<PanelDevice> panel,
+                                     const std::string& dataDir)
+    : mController(std::move(controller)),
+      mPanel(std::move(panel)),
+      mDataDir(dataDir),
+      mDefaultPath(dataDir + "default_display_mode"),
+      mDefaultTmpPath(mDefaultPath + ".tmp"),
+      mCurrentModeId(0),
+      mDefaultModeId(0),
+      mModeRequested(false),
+      mApplying(false),
+      mExit(false) {
+    std::ifstream defaultFile(mDefaultPath);
+
+    defaultFile >> mDefaultModeId;
+    LOG(DEBUG) << "Default file read result " << mDefaultModeId << " fail " << defaultFile.fail();
+    if (defaultFile.fail() || kModeMap.find(mDefaultModeId) == kModeMap.end()) {
+        mDefaultModeId = 0;
+        mPersistedDefaultModeId = -1;
+    } else {
+        mPersistedDefaultModeId = mDefaultModeId;
+    }
+    mCurrentModeId = mDefaultModeId;
+    publishModesLocked();
+
+    mApplyThread = std::thread(&DisplayModeEngine::applyLoop, this);
+}
+
+DisplayModeEngine::~DisplayModeEngine() {
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mExit = true;
+    }
+    mPendingCv.notify_one();
+    mApplyThread.join();
+}
+
+void DisplayModeEngine::registerDisplayModeSetCallback(DisplayModeSetCallback callback) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mOnDisplayModeSet = callback;
+}
+
+int32_t DisplayModeEngine::getCurrentModeId() {
+    return static_cast<int32_t>(mModeSnapshot.load(std::memory_order_acquire));
+}
+
+int32_t DisplayModeEngine::getDefaultModeId() {
+    return static_cast<int32_t>(mModeSnapshot.load(std::memory_order_acquire) >> 32);
+}
+
+void DisplayModeEngine::publishModesLocked() {
+    mModeSnapshot.store(static_cast<uint64_t>(static_cast<uint32_t>(mDefaultModeId)) << 32 |
+                                static_cast<uint32_t>(mCurrentModeId),
+                        std::memory_order_release);
+}
+
+bool DisplayModeEngine::setDisplayMode(int32_t modeId, bool makeDefault) {
+    const auto iter = kModeMap.find(modeId);
+    if (iter == kModeMap.end()) {
+        return false;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mCurrentModeId = iter->first;
+        mPendingModeId = iter->first;
+        mModeRequested = true;
+        if (makeDefault) {
+            mDefaultModeId = iter->first;
+            mPendingDefaultModeId = iter->first;
+        }
+        publishModesLocked();
+    }
+    mPendingCv.notify_one();
+    return true;
+}
+
+void DisplayModeEngine::restoreDefaultDisplayMode() {
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        if (mModeRequested) {
+            // A client got there first.
+            return;
+        }
+        mPendingModeId = mDefaultModeId;
+    }
+    mPendingCv.notify_one();
+}
+
+void DisplayModeEngine::waitForIdle() {
+    std::unique_lock<std::mutex> lock(mMutex);
+    mIdleCv.wait(lock, [&] { return !mPendingModeId && !mPendingDefaultModeId && !mApplying; });
+}
+
+void DisplayModeEngine::applyLoop() {
+    std::unique_lock<std::mutex> lock(mMutex);
+    while (true) {
+        mPendingCv.wait(lock, [&] { return mExit || mPendingModeId || mPendingDefaultModeId; });
+        if (mExit) {
+            break;
+        }
+
+        std::optional<int32_t> modeId = std::exchange(mPendingModeId, std::nullopt);
+        std::optional<int32_t> defaultModeId = std::exchange(mPendingDefaultModeId, std::nullopt);
+        mApplying = true;
+        lock.unlock();
+
+        DisplayTransaction transaction;
+        if (modeId) {
+            const ModeInfo& mode = kModeMap.at(*modeId);
+            transaction.seedMode = mode.seedMode;
+            transaction.displayModeId = mode.displayModeId;
+        }
+        bool defaultApplied = true;
+        if (defaultModeId) {
+            // SDM only learns about the new default once it is safely on disk.
+            if (*defaultModeId == mPersistedDefaultModeId || writeDefaultFile(*defaultModeId)) {
+                transaction.defaultDisplayModeId = kModeMap.at(*defaultModeId).displayModeId;
+            } else {
+                defaultApplied = false;
+            }
+        }
+        commit(transaction);
+
+        lock.lock();
+        if (defaultModeId) {
+            if (defaultApplied) {
+                mPersistedDefaultModeId = *defaultModeId;
+            } else if (!mPendingDefaultModeId) {
+                mDefaultModeId = std::max(mPersistedDefaultModeId, 0);
+                publishModesLocked();
+            }
+        }
+        mApplying = false;
+        mIdleCv.notify_all();
+    }
+}
+
+bool DisplayModeEngine::commit(const DisplayTransaction& transaction) {
+    std::lock_guard<std::mutex> commitLock(mCommitMutex);
+    auto start = std::chrono::steady_clock::now();
+    bool success = true;
+    bool modeChanged = false;
+    bool noop = true;
+
+    if (transaction.seedMode && mAppliedSeedMode != transaction.seedMode) {
+        noop = false;
+        if (mPanel->setSeedMode(*transaction.seedMode)) {
+            mAppliedSeedMode = transaction.seedMode;
+        } else {
+            LOG(ERROR) << "Failed to set SEED mode " << *transaction.seedMode;
+            mAppliedSeedMode.reset();
+            success = false;
+        }
+    }
+    if (transaction.displayModeId && mAppliedDisplayModeId != transaction.displayModeId) {
+        noop = false;
+        if (mController->setActiveDisplayMode(*transaction.displayModeId) == 0) {
+            mAppliedDisplayModeId = transaction.displayModeId;
+            modeChanged = true;
+        } else {
+            LOG(ERROR) << "Failed to set display mode " << *transaction.displayModeId;
+            mAppliedDisplayModeId.reset();
+            success = false;
+        }
+    }
+    if (transaction.defaultDisplayModeId &&
+        mAppliedDefaultDisplayModeId != transaction.defaultDisplayModeId) {
+        noop = false;
+        if (mController->setDefaultDisplayMode(*transaction.defaultDisplayModeId) == 0) {
+            mAppliedDefaultDisplayModeId = transaction.defaultDisplayModeId;
+        } else {
+            LOG(ERROR) << "Failed to set default display mode "
+                       << *transaction.defaultDisplayModeId;
+            success = false;
+        }
+    }
+    // The default picture adjustment follows the SDM mode, refresh it only if that moved.
+    if (modeChanged || transaction.refreshPictureAdjustment) {
+        noop = false;
+        std::unique_lock<std::mutex> lock(mMutex);
+        DisplayModeSetCallback onDisplayModeSet = mOnDisplayModeSet;
+        lock.unlock();
+        if (onDisplayModeSet) {
+            onDisplayModeSet();
+        }
+    }
+
+    int64_t durationNs = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                 std::chrono::steady_clock::now() - start)
+                                 .count();
+    mCommitStats.count++;
+    if (noop) {
+        mCommitStats.noops++;
+    } else {
+        mCommitStats.totalNs += durationNs;
+        mCommitStats.maxNs = std::max(mCommitStats.maxNs, durationNs);
+        mCommitStats.lastNs = durationNs;
+        LOG(DEBUG) << "Display transaction applied in " << durationNs / 1000 << " us";
+    }
+    if (!success) {
+        mCommitStats.failures++;
+    }
+    return success;
+}
+
+// Replace the default mode file so that a crash leaves either the old or the new id behind.
+bool DisplayModeEngine::writeDefaultFile(int32_t modeId) {
+    unique_fd fd(TEMP_FAILURE_RETRY(
+            open(mDefaultTmpPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0660)));
+    if (fd < 0) {
+        PLOG(ERROR) << "Failed to open " << mDefaultTmpPath;
+        return false;
+    }
+    if (!WriteStringToFd(std::to_string(modeId), fd) || fsync(fd) != 0) {
+        PLOG(ERROR) << "Failed to write " << mDefaultTmpPath;
+        unlink(mDefaultTmpPath.c_str());
+        return false;
+    }
+    fd.reset();
+    if (rename(mDefaultTmpPath.c_str(), mDefaultPath.c_str()) != 0) {
+        PLOG(ERROR) << "Failed to rename " << mDefaultTmpPath;
+        unlink(mDefaultTmpPath.c_str());
+        return false;
+    }
+    unique_fd dirFd(
+            TEMP_FAILURE_RETRY(open(mDataDir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC)));
+    if (dirFd >= 0) {
+        fsync(dirFd);
+    }
+    return true;
+}
+
+void DisplayModeEngine::dump(std::ostream& stream) {
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        stream << "Current mode: " << mCurrentModeId << ", default mode: " << mDefaultModeId
+               << std::endl;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mCommitMutex);
+        const CommitStats& stats = mCommitStats;
+        uint64_t applied = stats.count - stats.noops;
+        stream << "Transactions: " << stats.count << " (" << stats.noops << " no-op, "
+               << stats.failures << " failed)" << std::endl;
+        stream << "Transaction latency: avg " << (applied > 0 ? stats.totalNs / applied : 0) / 1000
+               << " us, max " << stats.maxNs / 1000 << " us, last " << stats.lastNs / 1000
+               << " us" << std::endl;
+    }
+}
+
+}  // namespace implementation
+}  // namespace V2_1
+}  // namespace livedisplay
+}  // namespace lineage
+}  // namespace vendor
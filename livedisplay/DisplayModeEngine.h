@@ -0,0 +1,133 @@
+/*
+ * Copyright (C) 2024 The LineageOS Project
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef VENDOR_LINEAGE_LIVEDISPLAY_V2_1_DISPLAYMODEENGINE_H
+#define VENDOR_LINEAGE_LIVEDISPLAY_V2_1_DISPLAYMODEENGINE_H
+
+#include "DisplayBackend.h"
+#include "DisplayTransaction.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <ostream>
+#include <string>
+#include <thread>
+
+namespace vendor {
+namespace lineage {
+namespace livedisplay {
+namespace V2_1 {
+namespace implementation {
+
+/*
+ * Display mode logic behind IDisplayModes, free of HIDL so that it also builds for the host.
+ *
+ * Mode changes are applied by a worker thread. Requests that arrive while it is busy only
+ * replace the pending target, so a burst of changes ends up applying the last one.
+ */
+class DisplayModeEngine {
+  public:
+    struct ModeInfo {
+        std::string name;
+        int32_t displayModeId;
+        uint32_t seedMode;
+    };
+    static const std::map<int32_t, ModeInfo> kModeMap;
+
+    /*
+     * @param controller Applies SDM display modes.
+     * @param panel Applies SEED modes.
+     * @param dataDir Directory holding the default_display_mode file, with a trailing slash.
+     */
+    DisplayModeEngine(std::shared_ptr<DisplayController> controller,
+                      std::shared_ptr<PanelDevice> panel, const std::string& dataDir);
+    ~DisplayModeEngine();
+
+    using DisplayModeSetCallback = std::function<void()>;
+    void registerDisplayModeSetCallback(DisplayModeSetCallback callback);
+
+    // Never block, they read the last published snapshot.
+    int32_t getCurrentModeId();
+    int32_t getDefaultModeId();
+
+    // Validates the mode and queues it, returns false for unknown modes.
+    bool setDisplayMode(int32_t modeId, bool makeDefault);
+
+    // Queues applying the persisted default mode, unless a mode was already requested.
+    void restoreDefaultDisplayMode();
+
+    // Blocks until every mode change requested so far has been applied.
+    void waitForIdle();
+
+    /*
+     * Apply the staged parts of a transaction that differ from the current hardware state,
+     * followed by the picture adjustment callback if needed.
+     *
+     * @return false if any part failed to apply.
+     */
+    bool commit(const DisplayTransaction& transaction);
+
+    void dump(std::ostream& stream);
+
+  private:
+    void applyLoop();
+    bool writeDefaultFile(int32_t modeId);
+    void publishModesLocked();
+
+    std::shared_ptr<DisplayController> mController;
+    std::shared_ptr<PanelDevice> mPanel;
+    const std::string mDataDir;
+    const std::string mDefaultPath;
+    const std::string mDefaultTmpPath;
+
+    // Requested modes, guarded by mMutex. Setters are serialized on it and publish both ids
+    // in mModeSnapshot, current in the low and default in the high half, so that readers get
+    // a consistent pair without taking the lock.
+    int32_t mCurrentModeId;
+    int32_t mDefaultModeId;
+    std::atomic<uint64_t> mModeSnapshot;
+    int32_t mPersistedDefaultModeId;
+    DisplayModeSetCallback mOnDisplayModeSet;
+
+    std::mutex mMutex;
+    std::condition_variable mPendingCv;
+    std::condition_variable mIdleCv;
+    std::optional<int32_t> mPendingModeId;
+    std::optional<int32_t> mPendingDefaultModeId;
+    bool mModeRequested;
+    bool mApplying;
+    bool mExit;
+    std::thread mApplyThread;
+
+    // What the hardware was last told, guarded by mCommitMutex. Calls that would not change
+    // any of it are skipped.
+    std::mutex mCommitMutex;
+    std::optional<uint32_t> mAppliedSeedMode;
+    std::optional<int32_t> mAppliedDisplayModeId;
+    std::optional<int32_t> mAppliedDefaultDisplayModeId;
+
+    struct CommitStats {
+        uint64_t count;
+        uint64_t noops;
+        uint64_t failures;
+        int64_t totalNs;
+        int64_t maxNs;
+        int64_t lastNs;
+    } mCommitStats = {};
+};
+
+}  // namespace implementation
+}  // namespace V2_1
+}  // namespace livedisplay
+}  // namespace lineage
+}  // namespace vendor
+
+#endif  // VENDOR_LINEAGE_LIVEDISPLAY_V2_1_DISPLAYMODEENGINE_H
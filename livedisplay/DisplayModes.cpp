@@ -8,12 +8,16 @@
 
 #include "DisplayModes.h"
 
+#include <android-base/file.h>
 #include <android-base/logging.h>
-#include <android-base/properties.h>
+#include <android-base/unique_fd.h>
 #include <fcntl.h>
 #include <oplus/oplus_display_panel.h>
 
-#include <fstream>
+#include <sstream>
+#include <utility>
+
+using android::base::unique_fd;
 
 namespace vendor {
 namespace lineage {
@@ -22,72 +26,95 @@ namespace V2_1 {
 namespace implementation {
 
 static const std::string kModeBasePath = "/sys/class/drm/card0-DSI-1/";
-static const std::string kDefaultPath = "/data/vendor/display/default_display_mode";
-
-// Mode ids here must match qdcm display mode ids
-const std::map<int32_t, DisplayModes::ModeInfo> DisplayModes::kModeMap = {
-        {0, {"Vivid", 0, 0}},
-        {1, {"Natural", 1, 1}},
-        {2, {"Cinematic", 0, 1}},
-        {3, {"Brilliant", 4, 0}},
+static const std::string kDataDir = "/data/vendor/display/";
+
+// Called from the worker, so every SDM call goes under the lock shared with picture adjustment.
+class SdmDisplayController : public DisplayController {
+  public:
+    SdmDisplayController(std::shared_ptr<V2_0::sdm::SDMController> controller,
+                         std::shared_ptr<std::mutex> sdmMutex)
+        : mController(std::move(controller)), mSdmMutex(std::move(sdmMutex)) {}
+
+    int32_t setActiveDisplayMode(int32_t displayModeId) override {
+        std::lock_guard<std::mutex> lock(*mSdmMutex);
+        return mController->setActiveDisplayMode(displayModeId);
+    }
+
+    int32_t setDefaultDisplayMode(int32_t displayModeId) override {
+        std::lock_guard<std::mutex> lock(*mSdmMutex);
+        return mController->setDefaultDisplayMode(displayModeId);
+    }
+
+  private:
+    std::shared_ptr<V2_0::sdm::SDMController> mController;
+    std::shared_ptr<std::mutex> mSdmMutex;
 };
 
-DisplayModes::DisplayModes(std::shared_ptr<V2_0::sdm::SDMController> controller)
-    : mController(std::move(controller)),
-      mOplusDisplayFd(open("/dev/oplus_display", O_RDWR)),
-      mCurrentModeId(0),
-      mDefaultModeId(0) {
-    std::ifstream defaultFile(kDefaultPath);
+class OplusPanelDevice : public PanelDevice {
+  public:
+    bool setSeedMode(uint32_t seedMode) override {
+        // Opened on first use to keep it off the service startup path.
+        if (mFd < 0) {
+            mFd.reset(TEMP_FAILURE_RETRY(open("/dev/oplus_display", O_RDWR | O_CLOEXEC)));
+            if (mFd < 0) {
+                PLOG(ERROR) << "Failed to open /dev/oplus_display";
+                return false;
+            }
+        }
+        if (ioctl(mFd, PANEL_IOCTL_SET_SEED, &seedMode) != 0) {
+            PLOG(ERROR) << "PANEL_IOCTL_SET_SEED failed";
+            return false;
+        }
+        return true;
+    }
 
-    defaultFile >> mDefaultModeId;
-    LOG(DEBUG) << "Default file read result " << mDefaultModeId << " fail " << defaultFile.fail();
+  private:
+    unique_fd mFd;
+};
 
-    setDisplayMode(mDefaultModeId, false);
+DisplayModes::DisplayModes(std::shared_ptr<V2_0::sdm::SDMController> controller,
+                           std::shared_ptr<std::mutex> sdmMutex)
+    : mEngine(std::make_shared<SdmDisplayController>(std::move(controller), std::move(sdmMutex)),
+              std::make_shared<OplusPanelDevice>(), kDataDir) {
+    std::vector<V2_0::DisplayMode> modes;
+    for (const auto& entry : DisplayModeEngine::kModeMap) {
+        modes.push_back({entry.first, entry.second.name});
+        mModes[entry.first] = modes.back();
+    }
+    mModeList = modes;
 }
 
 // Methods from ::vendor::lineage::livedisplay::V2_1::IDisplayModes follow.
 Return<void> DisplayModes::getDisplayModes(getDisplayModes_cb resultCb) {
-    std::vector<V2_0::DisplayMode> modes;
-
-    for (const auto& entry : kModeMap) {
-        modes.push_back({entry.first, entry.second.name});
-    }
-    resultCb(modes);
+    resultCb(mModeList);
     return Void();
 }
 
 Return<void> DisplayModes::getCurrentDisplayMode(getCurrentDisplayMode_cb resultCb) {
-    resultCb({mCurrentModeId, kModeMap.at(mCurrentModeId).name});
+    resultCb(mModes.at(mEngine.getCurrentModeId()));
     return Void();
 }
 
 Return<void> DisplayModes::getDefaultDisplayMode(getDefaultDisplayMode_cb resultCb) {
-    resultCb({mDefaultModeId, kModeMap.at(mDefaultModeId).name});
+    resultCb(mModes.at(mEngine.getDefaultModeId()));
     return Void();
 }
 
 Return<bool> DisplayModes::setDisplayMode(int32_t modeID, bool makeDefault) {
-    const auto iter = kModeMap.find(modeID);
-    if (iter == kModeMap.end()) {
-        return false;
-    }
-    if (mOplusDisplayFd >= 0) {
-        ioctl(mOplusDisplayFd, PANEL_IOCTL_SET_SEED, &iter->second.seedMode);
-    }
-    mController->setActiveDisplayMode(iter->second.displayModeId);
-    mCurrentModeId = iter->first;
-    if (makeDefault) {
-        std::ofstream defaultFile(kDefaultPath);
-        defaultFile << iter->first;
-        if (!defaultFile.fail()) {
-            mController->setDefaultDisplayMode(iter->second.displayModeId);
-            mDefaultModeId = iter->first;
-        }
-    }
-    if (mOnDisplayModeSet) {
-        mOnDisplayModeSet();
+    return mEngine.setDisplayMode(modeID, makeDefault);
+}
+
+// Methods from ::android::hidl::base::V1_0::IBase follow.
+Return<void> DisplayModes::debug(const hidl_handle& handle,
+                                 const hidl_vec<hidl_string>& /* options */) {
+    if (handle == nullptr || handle->numFds < 1) {
+        return Void();
     }
-    return true;
+
+    std::ostringstream stream;
+    mEngine.dump(stream);
+    android::base::WriteStringToFd(stream.str(), handle->data[0]);
+    return Void();
 }
 
 }  // namespace implementation
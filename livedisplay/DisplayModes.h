@@ -11,7 +11,11 @@
 #include <hidl/Status.h>
 #include <livedisplay/sdm/SDMController.h>
 #include <vendor/lineage/livedisplay/2.1/IDisplayModes.h>
-#include <map>
+
+#include "DisplayModeEngine.h"
+
+#include <memory>
+#include <mutex>
 
 namespace vendor {
 namespace lineage {
@@ -20,36 +24,41 @@ namespace V2_1 {
 namespace implementation {
 
 using ::android::sp;
+using ::android::hardware::hidl_handle;
+using ::android::hardware::hidl_string;
+using ::android::hardware::hidl_vec;
 using ::android::hardware::Return;
 using ::android::hardware::Void;
 
 class DisplayModes : public IDisplayModes {
   public:
-    DisplayModes(std::shared_ptr<V2_0::sdm::SDMController> controller);
+    /*
+     * @param sdmMutex Held around every SDM call, shared with the other users of the controller.
+     */
+    DisplayModes(std::shared_ptr<V2_0::sdm::SDMController> controller,
+                 std::shared_ptr<std::mutex> sdmMutex);
 
-    using DisplayModeSetCallback = std::function<void()>;
+    using DisplayModeSetCallback = DisplayModeEngine::DisplayModeSetCallback;
     inline void registerDisplayModeSetCallback(DisplayModeSetCallback callback) {
-        mOnDisplayModeSet = callback;
+        mEngine.registerDisplayModeSetCallback(callback);
     }
 
+    inline void restoreDefaultDisplayMode() { mEngine.restoreDefaultDisplayMode(); }
+
     // Methods from ::vendor::lineage::livedisplay::V2_1::IDisplayModes follow.
     Return<void> getDisplayModes(getDisplayModes_cb resultCb) override;
     Return<void> getCurrentDisplayMode(getCurrentDisplayMode_cb resultCb) override;
     Return<void> getDefaultDisplayMode(getDefaultDisplayMode_cb ResultCb) override;
     Return<bool> setDisplayMode(int32_t modeID, bool makeDefault) override;
 
+    // Methods from ::android::hidl::base::V1_0::IBase follow.
+    Return<void> debug(const hidl_handle& handle, const hidl_vec<hidl_string>& options) override;
+
   private:
-    struct ModeInfo {
-        std::string name;
-        int32_t displayModeId;
-        uint32_t seedMode;
-    };
-    static const std::map<int32_t, ModeInfo> kModeMap;
-    std::shared_ptr<V2_0::sdm::SDMController> mController;
-    int32_t mOplusDisplayFd;
-    int32_t mCurrentModeId;
-    int32_t mDefaultModeId;
-    DisplayModeSetCallback mOnDisplayModeSet;
+    DisplayModeEngine mEngine;
+    // Built once, the mode list never changes.
+    std::map<int32_t, V2_0::DisplayMode> mModes;
+    hidl_vec<V2_0::DisplayMode> mModeList;
 };
 
 }  // namespace implementation
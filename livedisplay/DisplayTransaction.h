@@ -0,0 +1,43 @@
+/*
+ * Copyright (C) 2024 The LineageOS Project
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef VENDOR_LINEAGE_LIVEDISPLAY_V2_1_DISPLAYTRANSACTION_H
+#define VENDOR_LINEAGE_LIVEDISPLAY_V2_1_DISPLAYTRANSACTION_H
+
+#include <cstdint>
+#include <optional>
+
+namespace vendor {
+namespace lineage {
+namespace livedisplay {
+namespace V2_1 {
+namespace implementation {
+
+/*
+ * A staged change of the display color state. Only the parts that are set are applied, and
+ * DisplayModeEngine::commit() applies all of them back to back without anything else reaching
+ * the panel or SDM in between.
+ */
+struct DisplayTransaction {
+    std::optional<uint32_t> seedMode;
+    std::optional<int32_t> displayModeId;
+    std::optional<int32_t> defaultDisplayModeId;
+    // The default picture adjustment is always refreshed when the display mode changes, this
+    // forces it otherwise.
+    bool refreshPictureAdjustment = false;
+
+    bool empty() const {
+        return !seedMode && !displayModeId && !defaultDisplayModeId && !refreshPictureAdjustment;
+    }
+};
+
+}  // namespace implementation
+}  // namespace V2_1
+}  // namespace livedisplay
+}  // namespace lineage
+}  // namespace vendor
+
+#endif  // VENDOR_LINEAGE_LIVEDISPLAY_V2_1_DISPLAYTRANSACTION_H
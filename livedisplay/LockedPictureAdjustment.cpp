@@ -0,0 +1,74 @@
+/*
+ * Copyright (C) 2024 The LineageOS Project
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "LockedPictureAdjustment.h"
+
+#include <utility>
+
+namespace vendor {
+namespace lineage {
+namespace livedisplay {
+namespace V2_1 {
+namespace implementation {
+
+LockedPictureAdjustment::LockedPictureAdjustment(
+        std::shared_ptr<V2_0::sdm::SDMController> controller, std::shared_ptr<std::mutex> sdmMutex)
+    : mPictureAdjustment(new V2_0::sdm::PictureAdjustment(std::move(controller))),
+      mSdmMutex(std::move(sdmMutex)) {}
+
+void LockedPictureAdjustment::updateDefaultPictureAdjustment() {
+    std::lock_guard<std::mutex> lock(*mSdmMutex);
+    mPictureAdjustment->updateDefaultPictureAdjustment();
+}
+
+// Methods from ::vendor::lineage::livedisplay::V2_0::IPictureAdjustment follow.
+Return<void> LockedPictureAdjustment::getHueRange(getHueRange_cb resultCb) {
+    std::lock_guard<std::mutex> lock(*mSdmMutex);
+    return mPictureAdjustment->getHueRange(resultCb);
+}
+
+Return<void> LockedPictureAdjustment::getSaturationRange(getSaturationRange_cb resultCb) {
+    std::lock_guard<std::mutex> lock(*mSdmMutex);
+    return mPictureAdjustment->getSaturationRange(resultCb);
+}
+
+Return<void> LockedPictureAdjustment::getIntensityRange(getIntensityRange_cb resultCb) {
+    std::lock_guard<std::mutex> lock(*mSdmMutex);
+    return mPictureAdjustment->getIntensityRange(resultCb);
+}
+
+Return<void> LockedPictureAdjustment::getContrastRange(getContrastRange_cb resultCb) {
+    std::lock_guard<std::mutex> lock(*mSdmMutex);
+    return mPictureAdjustment->getContrastRange(resultCb);
+}
+
+Return<void> LockedPictureAdjustment::getSaturationThresholdRange(
+        getSaturationThresholdRange_cb resultCb) {
+    std::lock_guard<std::mutex> lock(*mSdmMutex);
+    return mPictureAdjustment->getSaturationThresholdRange(resultCb);
+}
+
+Return<void> LockedPictureAdjustment::getPictureAdjustment(getPictureAdjustment_cb resultCb) {
+    std::lock_guard<std::mutex> lock(*mSdmMutex);
+    return mPictureAdjustment->getPictureAdjustment(resultCb);
+}
+
+Return<void> LockedPictureAdjustment::getDefaultPictureAdjustment(
+        getDefaultPictureAdjustment_cb resultCb) {
+    std::lock_guard<std::mutex> lock(*mSdmMutex);
+    return mPictureAdjustment->getDefaultPictureAdjustment(resultCb);
+}
+
+Return<bool> LockedPictureAdjustment::setPictureAdjustment(const V2_0::HSIC& hsic) {
+    std::lock_guard<std::mutex> lock(*mSdmMutex);
+    return mPictureAdjustment->setPictureAdjustment(hsic);
+}
+
+}  // namespace implementation
+}  // namespace V2_1
+}  // namespace livedisplay
+}  // namespace lineage
+}  // namespace vendor
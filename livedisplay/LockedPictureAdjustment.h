@@ -0,0 +1,59 @@
+/*
+ * Copyright (C) 2024 The LineageOS Project
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef VENDOR_LINEAGE_LIVEDISPLAY_V2_1_LOCKEDPICTUREADJUSTMENT_H
+#define VENDOR_LINEAGE_LIVEDISPLAY_V2_1_LOCKEDPICTUREADJUSTMENT_H
+
+#include <livedisplay/sdm/PictureAdjustment.h>
+#include <vendor/lineage/livedisplay/2.0/IPictureAdjustment.h>
+
+#include <memory>
+#include <mutex>
+
+namespace vendor {
+namespace lineage {
+namespace livedisplay {
+namespace V2_1 {
+namespace implementation {
+
+using ::android::sp;
+using ::android::hardware::Return;
+
+/*
+ * Serves IPictureAdjustment from the SDM implementation under the lock that also guards the
+ * display mode worker's SDM calls. Neither SDMController nor PictureAdjustment is thread-safe,
+ * and the worker refreshes the default picture adjustment behind the binder threads' backs.
+ */
+class LockedPictureAdjustment : public V2_0::IPictureAdjustment {
+  public:
+    LockedPictureAdjustment(std::shared_ptr<V2_0::sdm::SDMController> controller,
+                            std::shared_ptr<std::mutex> sdmMutex);
+
+    // The display mode set callback, runs on the display mode worker.
+    void updateDefaultPictureAdjustment();
+
+    // Methods from ::vendor::lineage::livedisplay::V2_0::IPictureAdjustment follow.
+    Return<void> getHueRange(getHueRange_cb resultCb) override;
+    Return<void> getSaturationRange(getSaturationRange_cb resultCb) override;
+    Return<void> getIntensityRange(getIntensityRange_cb resultCb) override;
+    Return<void> getContrastRange(getContrastRange_cb resultCb) override;
+    Return<void> getSaturationThresholdRange(getSaturationThresholdRange_cb resultCb) override;
+    Return<void> getPictureAdjustment(getPictureAdjustment_cb resultCb) override;
+    Return<void> getDefaultPictureAdjustment(getDefaultPictureAdjustment_cb resultCb) override;
+    Return<bool> setPictureAdjustment(const V2_0::HSIC& hsic) override;
+
+  private:
+    sp<V2_0::sdm::PictureAdjustment> mPictureAdjustment;
+    std::shared_ptr<std::mutex> mSdmMutex;
+};
+
+}  // namespace implementation
+}  // namespace V2_1
+}  // namespace livedisplay
+}  // namespace lineage
+}  // namespace vendor
+
+#endif  // VENDOR_LINEAGE_LIVEDISPLAY_V2_1_LOCKEDPICTUREADJUSTMENT_H
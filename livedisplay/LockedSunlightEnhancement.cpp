@@ -0,0 +1,35 @@
+/*
+ * Copyright (C) 2024 The LineageOS Project
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "LockedSunlightEnhancement.h"
+
+#include <utility>
+
+namespace vendor {
+namespace lineage {
+namespace livedisplay {
+namespace V2_1 {
+namespace implementation {
+
+LockedSunlightEnhancement::LockedSunlightEnhancement(std::shared_ptr<std::mutex> sdmMutex)
+    : mSunlightEnhancement(new SunlightEnhancement()), mSdmMutex(std::move(sdmMutex)) {}
+
+// Methods from ::vendor::lineage::livedisplay::V2_0::ISunlightEnhancement follow.
+Return<bool> LockedSunlightEnhancement::isEnabled() {
+    std::lock_guard<std::mutex> lock(*mSdmMutex);
+    return mSunlightEnhancement->isEnabled();
+}
+
+Return<bool> LockedSunlightEnhancement::setEnabled(bool enabled) {
+    std::lock_guard<std::mutex> lock(*mSdmMutex);
+    return mSunlightEnhancement->setEnabled(enabled);
+}
+
+}  // namespace implementation
+}  // namespace V2_1
+}  // namespace livedisplay
+}  // namespace lineage
+}  // namespace vendor
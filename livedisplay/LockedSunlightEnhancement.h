@@ -0,0 +1,49 @@
+/*
+ * Copyright (C) 2024 The LineageOS Project
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef VENDOR_LINEAGE_LIVEDISPLAY_V2_1_LOCKEDSUNLIGHTENHANCEMENT_H
+#define VENDOR_LINEAGE_LIVEDISPLAY_V2_1_LOCKEDSUNLIGHTENHANCEMENT_H
+
+#include <livedisplay/oplus/SunlightEnhancement.h>
+#include <vendor/lineage/livedisplay/2.1/ISunlightEnhancement.h>
+
+#include <memory>
+#include <mutex>
+
+namespace vendor {
+namespace lineage {
+namespace livedisplay {
+namespace V2_1 {
+namespace implementation {
+
+using ::android::sp;
+using ::android::hardware::Return;
+
+/*
+ * Serves ISunlightEnhancement under the lock the display mode worker and picture adjustment
+ * take around their SDM calls, so that display setters stay ordered with the thread pool
+ * serving calls concurrently.
+ */
+class LockedSunlightEnhancement : public ISunlightEnhancement {
+  public:
+    explicit LockedSunlightEnhancement(std::shared_ptr<std::mutex> sdmMutex);
+
+    // Methods from ::vendor::lineage::livedisplay::V2_0::ISunlightEnhancement follow.
+    Return<bool> isEnabled() override;
+    Return<bool> setEnabled(bool enabled) override;
+
+  private:
+    sp<SunlightEnhancement> mSunlightEnhancement;
+    std::shared_ptr<std::mutex> mSdmMutex;
+};
+
+}  // namespace implementation
+}  // namespace V2_1
+}  // namespace livedisplay
+}  // namespace lineage
+}  // namespace vendor
+
+#endif  // VENDOR_LINEAGE_LIVEDISPLAY_V2_1_LOCKEDSUNLIGHTENHANCEMENT_H
@@ -0,0 +1,305 @@
+/*
+ * Copyright (C) 2024 The LineageOS Project
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * Host benchmark for the LiveDisplay display mode engine. Runs DisplayModeEngine against fake
+ * SDM and panel backends with the default mode file on tmpfs, checks that every mode reaches
+ * the expected SEED and SDM ids, and reports switch latency, hardware calls per switch and
+ * getter latency while setters run concurrently.
+ */
+
+#include "DisplayModeEngine.h"
+#include "bench/FakeDisplayBackend.h"
+
+#include <android-base/file.h>
+#include <android-base/parseint.h>
+
+#include <getopt.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+using android::base::ParseUint;
+using android::base::ReadFileToString;
+using namespace vendor::lineage::livedisplay::V2_1::implementation;
+using Clock = std::chrono::steady_clock;
+
+struct Options {
+    unsigned int iterations = 200;
+    unsigned int delayUs = 500;
+    unsigned int readers = 4;
+    unsigned int writers = 2;
+    unsigned int durationMs = 2000;
+};
+
+struct ExpectedMode {
+    int32_t id;
+    const char* name;
+    int32_t displayModeId;
+    uint32_t seedMode;
+};
+
+// What the panel and QDCM calibration on these devices expect, see DisplayModeEngine.cpp.
+static const ExpectedMode kExpectedModes[] = {
+        {0, "Vivid", 0, 0},
+        {1, "Natural", 1, 1},
+        {2, "Cinematic", 0, 1},
+        {3, "Brilliant", 4, 0},
+};
+
+static int failures;
+
+#define CHECK_BENCH(cond, ...)              \
+    do {                                    \
+        if (!(cond)) {                      \
+            fprintf(stderr, "FAIL: ");      \
+            fprintf(stderr, __VA_ARGS__);   \
+            fprintf(stderr, "\n");          \
+            failures++;                     \
+        }                                   \
+    } while (0)
+
+static int64_t elapsedUs(Clock::time_point start) {
+    return std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - start).count();
+}
+
+class Fixture {
+  public:
+    explicit Fixture(const Options& options) {
+        const char* base = access("/dev/shm", W_OK) == 0 ? "/dev/shm" : "/tmp";
+        std::string pattern = std::string(base) + "/livedisplay-bench-XXXXXX";
+        if (mkdtemp(pattern.data()) == nullptr) {
+            perror("mkdtemp");
+            exit(1);
+        }
+        dir = pattern + "/";
+        controller = std::make_shared<FakeDisplayController>(
+                std::chrono::microseconds(options.delayUs));
+        panel = std::make_shared<FakePanelDevice>(std::chrono::microseconds(options.delayUs));
+        engine = std::make_unique<DisplayModeEngine>(controller, panel, dir);
+        engine->registerDisplayModeSetCallback([this] { paRefreshes++; });
+    }
+
+    ~Fixture() {
+        engine.reset();
+        unlink((dir + "default_display_mode").c_str());
+        rmdir(dir.c_str());
+    }
+
+    uint64_t calls() { return controller->calls() + panel->calls() + paRefreshes; }
+
+    std::string dir;
+    std::shared_ptr<FakeDisplayController> controller;
+    std::shared_ptr<FakePanelDevice> panel;
+    std::unique_ptr<DisplayModeEngine> engine;
+    std::atomic<uint64_t> paRefreshes = 0;
+};
+
+static void checkModeMap(const Options& options) {
+    printf("Mode map\n");
+    CHECK_BENCH(DisplayModeEngine::kModeMap.size() == std::size(kExpectedModes),
+                "expected %zu modes, got %zu", std::size(kExpectedModes),
+                DisplayModeEngine::kModeMap.size());
+
+    Fixture fixture(options);
+    for (const auto& expected : kExpectedModes) {
+        auto iter = DisplayModeEngine::kModeMap.find(expected.id);
+        if (iter == DisplayModeEngine::kModeMap.end()) {
+            CHECK_BENCH(false, "mode %" PRId32 " missing", expected.id);
+            continue;
+        }
+        CHECK_BENCH(iter->second.name == expected.name, "mode %" PRId32 " is named %s",
+                    expected.id, iter->second.name.c_str());
+
+        CHECK_BENCH(fixture.engine->setDisplayMode(expected.id, true), "set %" PRId32,
+                    expected.id);
+        fixture.engine->waitForIdle();
+        CHECK_BENCH(fixture.panel->seedMode() == expected.seedMode,
+                    "mode %" PRId32 " did not set SEED %" PRIu32, expected.id, expected.seedMode);
+        CHECK_BENCH(fixture.controller->activeDisplayModeId() == expected.displayModeId,
+                    "mode %" PRId32 " did not set display mode %" PRId32, expected.id,
+                    expected.displayModeId);
+        CHECK_BENCH(fixture.controller->defaultDisplayModeId() == expected.displayModeId,
+                    "mode %" PRId32 " did not set default display mode %" PRId32, expected.id,
+                    expected.displayModeId);
+        std::string persisted;
+        CHECK_BENCH(ReadFileToString(fixture.dir + "default_display_mode", &persisted) &&
+                            persisted == std::to_string(expected.id),
+                    "mode %" PRId32 " was not persisted", expected.id);
+        printf("  %" PRId32 " %-10s seed %" PRIu32 " display %" PRId32 "\n", expected.id,
+               expected.name, expected.seedMode, expected.displayModeId);
+    }
+    CHECK_BENCH(!fixture.engine->setDisplayMode(std::size(kExpectedModes), false),
+                "unknown mode accepted");
+}
+
+static void benchSwitches(const Options& options) {
+    Fixture fixture(options);
+    std::vector<int64_t> requestUs, applyUs;
+    uint64_t startCalls = fixture.calls();
+
+    for (unsigned int i = 0; i < options.iterations; i++) {
+        auto start = Clock::now();
+        fixture.engine->setDisplayMode((i + 1) % std::size(kExpectedModes), false);
+        requestUs.push_back(elapsedUs(start));
+        fixture.engine->waitForIdle();
+        applyUs.push_back(elapsedUs(start));
+    }
+    uint64_t calls = fixture.calls() - startCalls;
+
+    auto report = [](const char* label, std::vector<int64_t>& samples) {
+        std::sort(samples.begin(), samples.end());
+        int64_t total = 0;
+        for (int64_t sample : samples) total += sample;
+        printf("  %s: avg %" PRId64 " us, p50 %" PRId64 " us, max %" PRId64 " us\n", label,
+               total / static_cast<int64_t>(samples.size()), samples[samples.size() / 2],
+               samples.back());
+    };
+    printf("Sequential switches (%u, %u us per hardware call)\n", options.iterations,
+           options.delayUs);
+    report("setDisplayMode return", requestUs);
+    report("applied", applyUs);
+    printf("  hardware calls per switch: %.2f\n",
+           static_cast<double>(calls) / options.iterations);
+
+    // A burst of requests should collapse into a handful of commits.
+    startCalls = fixture.calls();
+    auto start = Clock::now();
+    for (unsigned int i = 0; i < options.iterations; i++) {
+        fixture.engine->setDisplayMode(i % std::size(kExpectedModes), false);
+    }
+    fixture.engine->waitForIdle();
+    printf("Burst of %u switches: applied in %" PRId64 " us with %" PRIu64 " hardware calls\n",
+           options.iterations, elapsedUs(start), fixture.calls() - startCalls);
+    int32_t last = (options.iterations - 1) % std::size(kExpectedModes);
+    CHECK_BENCH(fixture.controller->activeDisplayModeId() ==
+                        DisplayModeEngine::kModeMap.at(last).displayModeId,
+                "burst did not end on mode %" PRId32, last);
+}
+
+static void stressConcurrency(const Options& options) {
+    Fixture fixture(options);
+    std::atomic<bool> run = true;
+    std::atomic<uint64_t> reads = 0, invalid = 0;
+    std::atomic<int64_t> maxReadUs = 0;
+
+    std::vector<std::thread> threads;
+    for (unsigned int i = 0; i < options.readers; i++) {
+        threads.emplace_back([&] {
+            while (run.load()) {
+                auto start = Clock::now();
+                int32_t current = fixture.engine->getCurrentModeId();
+                int32_t def = fixture.engine->getDefaultModeId();
+                int64_t us = elapsedUs(start);
+                int64_t max = maxReadUs.load();
+                while (us > max && !maxReadUs.compare_exchange_weak(max, us)) {
+                }
+                if (DisplayModeEngine::kModeMap.count(current) == 0 ||
+                    DisplayModeEngine::kModeMap.count(def) == 0) {
+                    invalid++;
+                }
+                reads++;
+            }
+        });
+    }
+    std::atomic<uint64_t> writes = 0;
+    for (unsigned int i = 0; i < options.writers; i++) {
+        threads.emplace_back([&, i] {
+            std::mt19937 random(i);
+            while (run.load()) {
+                int32_t mode = random() % std::size(kExpectedModes);
+                fixture.engine->setDisplayMode(mode, random() % 8 == 0);
+                writes++;
+            }
+        });
+    }
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(options.durationMs));
+    run = false;
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    fixture.engine->waitForIdle();
+
+    printf("Concurrent stress (%u readers, %u writers, %u ms)\n", options.readers,
+           options.writers, options.durationMs);
+    printf("  reads: %" PRIu64 ", max getter latency %" PRId64 " us\n", reads.load(),
+           maxReadUs.load());
+    printf("  writes: %" PRIu64 ", hardware calls %" PRIu64 "\n", writes.load(), fixture.calls());
+    CHECK_BENCH(invalid == 0, "%" PRIu64 " getters returned unknown modes", invalid.load());
+
+    int32_t current = fixture.engine->getCurrentModeId();
+    CHECK_BENCH(fixture.controller->activeDisplayModeId() ==
+                        DisplayModeEngine::kModeMap.at(current).displayModeId,
+                "hardware does not match current mode %" PRId32 " after settling", current);
+    CHECK_BENCH(fixture.panel->seedMode() == DisplayModeEngine::kModeMap.at(current).seedMode,
+                "SEED does not match current mode %" PRId32 " after settling", current);
+    int32_t def = fixture.engine->getDefaultModeId();
+    std::string persisted;
+    CHECK_BENCH(!ReadFileToString(fixture.dir + "default_display_mode", &persisted) ||
+                        persisted == std::to_string(def),
+                "persisted default %s does not match %" PRId32, persisted.c_str(), def);
+}
+
+static void usage(const char* name) {
+    fprintf(stderr,
+            "Usage: %s [-n iterations] [-d hardware_delay_us] [-r readers] [-w writers] "
+            "[-t stress_ms]\n",
+            name);
+    exit(1);
+}
+
+int main(int argc, char** argv) {
+    Options options;
+    int opt;
+    while ((opt = getopt(argc, argv, "n:d:r:w:t:")) != -1) {
+        unsigned int* value;
+        switch (opt) {
+            case 'n':
+                value = &options.iterations;
+                break;
+            case 'd':
+                value = &options.delayUs;
+                break;
+            case 'r':
+                value = &options.readers;
+                break;
+            case 'w':
+                value = &options.writers;
+                break;
+            case 't':
+                value = &options.durationMs;
+                break;
+            default:
+                usage(argv[0]);
+        }
+        if (!ParseUint(optarg, value)) {
+            usage(argv[0]);
+        }
+    }
+    if (options.iterations == 0) {
+        usage(argv[0]);
+    }
+
+    checkModeMap(options);
+    benchSwitches(options);
+    stressConcurrency(options);
+
+    if (failures > 0) {
+        printf("%d check(s) failed\n", failures);
+        return 1;
+    }
+    printf("All checks passed\n");
+    return 0;
+}
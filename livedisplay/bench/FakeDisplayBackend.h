@@ -0,0 +1,106 @@
+/*
+ * Copyright (C) 2024 The LineageOS Project
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef VENDOR_LINEAGE_LIVEDISPLAY_V2_1_FAKEDISPLAYBACKEND_H
+#define VENDOR_LINEAGE_LIVEDISPLAY_V2_1_FAKEDISPLAYBACKEND_H
+
+#include "DisplayBackend.h"
+
+#include <chrono>
+#include <mutex>
+#include <optional>
+#include <thread>
+
+namespace vendor {
+namespace lineage {
+namespace livedisplay {
+namespace V2_1 {
+namespace implementation {
+
+/*
+ * In-memory stand-ins for SDM and the panel. Each call can be delayed to mimic the cost of the
+ * real QDCM round trip or ioctl, and is counted so callers can check what reached "hardware".
+ */
+class FakeDisplayController : public DisplayController {
+  public:
+    explicit FakeDisplayController(std::chrono::microseconds delay) : mDelay(delay) {}
+
+    int32_t setActiveDisplayMode(int32_t displayModeId) override {
+        std::this_thread::sleep_for(mDelay);
+        std::lock_guard<std::mutex> lock(mMutex);
+        mActiveCalls++;
+        mActiveDisplayModeId = displayModeId;
+        return 0;
+    }
+
+    int32_t setDefaultDisplayMode(int32_t displayModeId) override {
+        std::this_thread::sleep_for(mDelay);
+        std::lock_guard<std::mutex> lock(mMutex);
+        mDefaultCalls++;
+        mDefaultDisplayModeId = displayModeId;
+        return 0;
+    }
+
+    std::optional<int32_t> activeDisplayModeId() {
+        std::lock_guard<std::mutex> lock(mMutex);
+        return mActiveDisplayModeId;
+    }
+
+    std::optional<int32_t> defaultDisplayModeId() {
+        std::lock_guard<std::mutex> lock(mMutex);
+        return mDefaultDisplayModeId;
+    }
+
+    uint64_t calls() {
+        std::lock_guard<std::mutex> lock(mMutex);
+        return mActiveCalls + mDefaultCalls;
+    }
+
+  private:
+    const std::chrono::microseconds mDelay;
+    std::mutex mMutex;
+    std::optional<int32_t> mActiveDisplayModeId;
+    std::optional<int32_t> mDefaultDisplayModeId;
+    uint64_t mActiveCalls = 0;
+    uint64_t mDefaultCalls = 0;
+};
+
+class FakePanelDevice : public PanelDevice {
+  public:
+    explicit FakePanelDevice(std::chrono::microseconds delay) : mDelay(delay) {}
+
+    bool setSeedMode(uint32_t seedMode) override {
+        std::this_thread::sleep_for(mDelay);
+        std::lock_guard<std::mutex> lock(mMutex);
+        mCalls++;
+        mSeedMode = seedMode;
+        return true;
+    }
+
+    std::optional<uint32_t> seedMode() {
+        std::lock_guard<std::mutex> lock(mMutex);
+        return mSeedMode;
+    }
+
+    uint64_t calls() {
+        std::lock_guard<std::mutex> lock(mMutex);
+        return mCalls;
+    }
+
+  private:
+    const std::chrono::microseconds mDelay;
+    std::mutex mMutex;
+    std::optional<uint32_t> mSeedMode;
+    uint64_t mCalls = 0;
+};
+
+}  // namespace implementation
+}  // namespace V2_1
+}  // namespace livedisplay
+}  // namespace lineage
+}  // namespace vendor
+
+#endif  // VENDOR_LINEAGE_LIVEDISPLAY_V2_1_FAKEDISPLAYBACKEND_H
@@ -9,11 +9,11 @@
 #include <android-base/logging.h>
 #include <binder/ProcessState.h>
 #include <hidl/HidlTransportSupport.h>
-#include <livedisplay/oplus/SunlightEnhancement.h>
-#include <livedisplay/sdm/PictureAdjustment.h>
 #include <vendor/lineage/livedisplay/2.1/IPictureAdjustment.h>
 
 #include "DisplayModes.h"
+#include "LockedPictureAdjustment.h"
+#include "LockedSunlightEnhancement.h"
 
 using android::OK;
 using android::sp;
@@ -21,13 +21,13 @@ using android::status_t;
 using android::hardware::configureRpcThreadpool;
 using android::hardware::joinRpcThreadpool;
 
-using ::vendor::lineage::livedisplay::V2_0::sdm::PictureAdjustment;
 using ::vendor::lineage::livedisplay::V2_0::sdm::SDMController;
 using ::vendor::lineage::livedisplay::V2_1::IDisplayModes;
 using ::vendor::lineage::livedisplay::V2_1::IPictureAdjustment;
 using ::vendor::lineage::livedisplay::V2_1::ISunlightEnhancement;
 using ::vendor::lineage::livedisplay::V2_1::implementation::DisplayModes;
-using ::vendor::lineage::livedisplay::V2_1::implementation::SunlightEnhancement;
+using ::vendor::lineage::livedisplay::V2_1::implementation::LockedPictureAdjustment;
+using ::vendor::lineage::livedisplay::V2_1::implementation::LockedSunlightEnhancement;
 
 int main() {
     status_t status = OK;
@@ -37,11 +37,21 @@ int main() {
     LOG(INFO) << "LiveDisplay HAL service is starting.";
 
     std::shared_ptr<SDMController> controller = std::make_shared<SDMController>();
-    sp<DisplayModes> dm = new DisplayModes(controller);
-    sp<PictureAdjustment> pa = new PictureAdjustment(controller);
-    sp<SunlightEnhancement> se = new SunlightEnhancement();
+    // SDMController is not thread-safe, its users take this around every call. Sunlight
+    // enhancement takes it as well, keeping the display setters in order.
+    std::shared_ptr<std::mutex> sdmMutex = std::make_shared<std::mutex>();
+    sp<DisplayModes> dm = new DisplayModes(controller, sdmMutex);
+    sp<LockedPictureAdjustment> pa = new LockedPictureAdjustment(controller, sdmMutex);
+    sp<LockedSunlightEnhancement> se = new LockedSunlightEnhancement(sdmMutex);
 
-    configureRpcThreadpool(1, true /*callerWillJoin*/);
+    // Update default PA on setDisplayMode
+    dm->registerDisplayModeSetCallback(
+            std::bind(&LockedPictureAdjustment::updateDefaultPictureAdjustment, pa));
+
+    // Mode getters are answered from snapshots, give them threads of their own so that they do
+    // not queue behind picture adjustment or sunlight enhancement calls. Those are serialized
+    // on the SDM mutex above.
+    configureRpcThreadpool(4, true /*callerWillJoin*/);
 
     status = dm->registerAsService();
     if (status != OK) {
@@ -64,9 +74,8 @@ int main() {
         goto shutdown;
     }
 
-    // Update default PA on setDisplayMode
-    dm->registerDisplayModeSetCallback(
-            std::bind(&PictureAdjustment::updateDefaultPictureAdjustment, pa));
+    // Restore the default mode in the background rather than before registering.
+    dm->restoreDefaultDisplayMode();
 
     LOG(INFO) << "LiveDisplay HAL service is ready.";
     joinRpcThreadpool();
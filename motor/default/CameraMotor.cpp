@@ -0,0 +1,285 @@
+/*
+ * Copyright (C) 2024 The LineageOS Project
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#define LOG_TAG "vendor.lineage.oplus_motor.service"
+
+#include "CameraMotor.h"
+
+#include <android-base/file.h>
+#include <android-base/stringprintf.h>
+#include <android-base/strings.h>
+#include <log/log.h>
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstring>
+#include <memory>
+#include <thread>
+#include <dirent.h>
+#include <fcntl.h>
+#include <linux/input.h>
+#include <sys/ioctl.h>
+#include <time.h>
+#include <unistd.h>
+
+using android::base::StartsWith;
+using android::base::StringAppendF;
+using android::base::unique_fd;
+using aidl::vendor::lineage::oplus_motor::CameraMotor;
+using aidl::vendor::lineage::oplus_motor::MotorState;
+
+static constexpr const char* kDirectionPath = "/sys/class/motor/direction";
+static constexpr const char* kEnablePath = "/sys/class/motor/enable";
+static constexpr const char* kPositionPath = "/sys/class/motor/position";
+static constexpr const char* kInputPath = "/dev/input";
+
+// Motor event key codes, also handled by KeyHandler in camera_helper
+static constexpr int kMotorEventManualToDown = 184;
+static constexpr int kMotorEventUp = 185;
+static constexpr int kMotorEventUpAbnormal = 186;
+static constexpr int kMotorEventUpNormal = 187;
+static constexpr int kMotorEventDown = 188;
+static constexpr int kMotorEventDownAbnormal = 189;
+static constexpr int kMotorEventDownNormal = 190;
+
+// A move the driver has not reported done by then is given up on, so that it can be retried.
+static constexpr int64_t kMoveTimeoutNs = 3000000000LL;
+
+static int64_t nowNs() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static bool writeNode(int fd, const char* value) {
+    return TEMP_FAILURE_RETRY(pwrite(fd, value, strlen(value), 0)) > 0;
+}
+
+static bool hasKey(const uint8_t* keys, int code) {
+    return keys[code / 8] & (1 << (code % 8));
+}
+
+CameraMotor::CameraMotor()
+    : mDirectionFd(open(kDirectionPath, O_WRONLY | O_CLOEXEC)),
+      mEnableFd(open(kEnablePath, O_WRONLY | O_CLOEXEC)),
+      mPositionFd(open(kPositionPath, O_RDONLY | O_CLOEXEC)) {
+    if (mDirectionFd < 0 || mEnableFd < 0 || mPositionFd < 0) {
+        ALOGE("Failed to open motor nodes");
+    }
+    mStateSinceNs = nowNs();
+
+    openEventDevice();
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        refreshState(nowNs());
+    }
+    if (mEventFd >= 0) {
+        std::thread(&CameraMotor::readEvents, this).detach();
+    }
+}
+
+void CameraMotor::openEventDevice() {
+    std::unique_ptr<DIR, decltype(&closedir)> dir(opendir(kInputPath), closedir);
+    if (!dir) {
+        ALOGE("Failed to open %s", kInputPath);
+        return;
+    }
+    while (dirent* entry = readdir(dir.get())) {
+        if (!StartsWith(entry->d_name, "event")) {
+            continue;
+        }
+        std::string path = std::string(kInputPath) + "/" + entry->d_name;
+        unique_fd fd(open(path.c_str(), O_RDONLY | O_CLOEXEC));
+        uint8_t keys[KEY_MAX / 8 + 1] = {};
+        if (fd < 0 || ioctl(fd, EVIOCGBIT(EV_KEY, sizeof(keys)), keys) < 0 ||
+            !hasKey(keys, kMotorEventUpNormal) || !hasKey(keys, kMotorEventDownNormal)) {
+            continue;
+        }
+        int clock = CLOCK_MONOTONIC;
+        mEventTimestamps = ioctl(fd, EVIOCSCLOCKID, &clock) == 0;
+        ALOGI("Motor events from %s", path.c_str());
+        mEventDevice = path;
+        mEventFd = std::move(fd);
+        return;
+    }
+    ALOGW("No motor event device, following %s instead", kPositionPath);
+}
+
+void CameraMotor::readEvents() {
+    int fd = mEventFd.get();
+    input_event events[16];
+    while (true) {
+        ssize_t size = TEMP_FAILURE_RETRY(read(fd, events, sizeof(events)));
+        if (size < 0) {
+            ALOGE("Failed to read motor events: %s", strerror(errno));
+            break;
+        }
+        for (size_t i = 0; i < size / sizeof(input_event); i++) {
+            const input_event& event = events[i];
+            if (event.type != EV_KEY || event.value != 1) {
+                continue;
+            }
+            handleEvent(event.code, mEventTimestamps
+                                            ? event.input_event_sec * 1000000000LL +
+                                                      event.input_event_usec * 1000LL
+                                            : nowNs());
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(mMutex);
+    mEventFd.reset();
+}
+
+void CameraMotor::handleEvent(int code, int64_t timestampNs) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    switch (code) {
+        case kMotorEventManualToDown:
+            setState(MotorState::DOWN, timestampNs);
+            mMoves[1].pendingSinceNs = 0;
+            break;
+        case kMotorEventUp:
+            setState(MotorState::MOVING_UP, timestampNs);
+            break;
+        case kMotorEventUpAbnormal:
+            setState(MotorState::BLOCKED, timestampNs);
+            completeMove(true, true, timestampNs);
+            break;
+        case kMotorEventUpNormal:
+            setState(MotorState::UP, timestampNs);
+            completeMove(true, false, timestampNs);
+            break;
+        case kMotorEventDown:
+            setState(MotorState::MOVING_DOWN, timestampNs);
+            break;
+        case kMotorEventDownAbnormal:
+            setState(MotorState::BLOCKED, timestampNs);
+            completeMove(false, true, timestampNs);
+            break;
+        case kMotorEventDownNormal:
+            setState(MotorState::DOWN, timestampNs);
+            completeMove(false, false, timestampNs);
+            break;
+    }
+}
+
+void CameraMotor::refreshState(int64_t nowNs) {
+    if ((mState == MotorState::MOVING_UP || mState == MotorState::MOVING_DOWN) &&
+        nowNs - mStateSinceNs > kMoveTimeoutNs) {
+        ALOGW("Motor move not reported done, giving up on it");
+        setState(MotorState::UNKNOWN, nowNs);
+        mMoves[0].pendingSinceNs = 0;
+        mMoves[1].pendingSinceNs = 0;
+    }
+    // With motor events the position node is only needed to start from.
+    if (mState == MotorState::MOVING_UP || mState == MotorState::MOVING_DOWN ||
+        (mEventFd >= 0 && mState != MotorState::UNKNOWN)) {
+        return;
+    }
+
+    char position;
+    if (mPositionFd < 0 || TEMP_FAILURE_RETRY(pread(mPositionFd, &position, 1, 0)) != 1) {
+        return;
+    }
+    if (position == '0') {
+        setState(MotorState::UP, nowNs);
+    } else if (position == '1') {
+        setState(MotorState::DOWN, nowNs);
+    }
+}
+
+void CameraMotor::setState(MotorState state, int64_t nowNs) {
+    if (mState != state) {
+        mState = state;
+        mStateSinceNs = nowNs;
+    }
+}
+
+void CameraMotor::completeMove(bool up, bool blocked, int64_t timestampNs) {
+    MoveStats& stats = mMoves[up];
+    if (blocked) {
+        stats.blocked++;
+    }
+    if (stats.pendingSinceNs == 0) {
+        // Not commanded by us, e.g. the sensors HAL retracting the camera on a fall.
+        return;
+    }
+    if (!blocked) {
+        int64_t latencyNs = timestampNs - stats.pendingSinceNs;
+        stats.completed++;
+        stats.lastLatencyNs = latencyNs;
+        stats.totalLatencyNs += latencyNs;
+        stats.maxLatencyNs = std::max(stats.maxLatencyNs, latencyNs);
+    }
+    stats.pendingSinceNs = 0;
+}
+
+ndk::ScopedAStatus CameraMotor::move(bool up, bool* _aidl_return) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    int64_t start = nowNs();
+    refreshState(start);
+
+    MoveStats& stats = mMoves[up];
+    if (mState == (up ? MotorState::UP : MotorState::DOWN) ||
+        mState == (up ? MotorState::MOVING_UP : MotorState::MOVING_DOWN)) {
+        stats.coalesced++;
+        *_aidl_return = false;
+        return ndk::ScopedAStatus::ok();
+    }
+
+    if (!writeNode(mDirectionFd, up ? "1" : "0") || !writeNode(mEnableFd, "1")) {
+        ALOGE("Failed to move the camera %s: %s", up ? "up" : "down", strerror(errno));
+        return ndk::ScopedAStatus::fromServiceSpecificError(-1);
+    }
+    stats.commands++;
+    stats.writeNs += nowNs() - start;
+    stats.pendingSinceNs = start;
+    mMoves[!up].pendingSinceNs = 0;
+    setState(up ? MotorState::MOVING_UP : MotorState::MOVING_DOWN, start);
+    *_aidl_return = true;
+    return ndk::ScopedAStatus::ok();
+}
+
+ndk::ScopedAStatus CameraMotor::getStatus(MotorStatus* _aidl_return) {
+    std::lock_guard<std::mutex> lock(mMutex);
+    refreshState(nowNs());
+    _aidl_return->state = mState;
+    _aidl_return->commands = mMoves[0].commands + mMoves[1].commands;
+    _aidl_return->coalesced = mMoves[0].coalesced + mMoves[1].coalesced;
+    _aidl_return->lastUpLatencyNs = mMoves[1].lastLatencyNs;
+    _aidl_return->lastDownLatencyNs = mMoves[0].lastLatencyNs;
+    return ndk::ScopedAStatus::ok();
+}
+
+binder_status_t CameraMotor::dump(int fd, const char** /* args */, uint32_t /* numArgs */) {
+    std::string out;
+    std::lock_guard<std::mutex> lock(mMutex);
+    refreshState(nowNs());
+    StringAppendF(&out, "State: %s for %" PRId64 " ms\n", toString(mState).c_str(),
+                  (nowNs() - mStateSinceNs) / 1000000);
+    StringAppendF(&out, "Events: %s\n",
+                  mEventFd >= 0 ? mEventDevice.c_str() : "none, following the position node");
+    for (bool up : {true, false}) {
+        const MoveStats& stats = mMoves[up];
+        StringAppendF(&out,
+                      "  %-4s: %" PRIu64 " commands, %" PRIu64 " coalesced, %" PRIu64
+                      " completed, %" PRIu64 " blocked\n",
+                      up ? "up" : "down", stats.commands, stats.coalesced, stats.completed,
+                      stats.blocked);
+        StringAppendF(&out,
+                      "        write avg %" PRId64 " us, latency last %" PRId64 " ms, avg %" PRId64
+                      " ms, max %" PRId64 " ms\n",
+                      stats.commands > 0
+                              ? stats.writeNs / static_cast<int64_t>(stats.commands) / 1000
+                              : 0,
+                      stats.lastLatencyNs < 0 ? 0 : stats.lastLatencyNs / 1000000,
+                      stats.completed > 0 ? stats.totalLatencyNs /
+                                                    static_cast<int64_t>(stats.completed) / 1000000
+                                          : 0,
+                      stats.maxLatencyNs / 1000000);
+    }
+    android::base::WriteStringToFd(out, fd);
+    return STATUS_OK;
+}
@@ -0,0 +1,76 @@
+/*
+ * Copyright (C) 2024 The LineageOS Project
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <aidl/vendor/lineage/oplus_motor/BnCameraMotor.h>
+#include <android-base/unique_fd.h>
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+
+namespace aidl {
+namespace vendor {
+namespace lineage {
+namespace oplus_motor {
+
+/**
+ * Drives the pop-up camera motor through /sys/class/motor, keeping its nodes open. The motor
+ * state follows the key events the motor driver reports, so commands that would not change
+ * anything, such as raising a camera that is up or already going up, are dropped.
+ */
+class CameraMotor : public BnCameraMotor {
+  public:
+    CameraMotor();
+    ndk::ScopedAStatus move(bool up, bool* _aidl_return) override;
+    ndk::ScopedAStatus getStatus(MotorStatus* _aidl_return) override;
+    binder_status_t dump(int fd, const char** args, uint32_t numArgs) override;
+
+  private:
+    struct MoveStats {
+        uint64_t commands = 0;
+        uint64_t coalesced = 0;
+        uint64_t completed = 0;
+        uint64_t blocked = 0;
+        // Time spent writing the motor nodes.
+        int64_t writeNs = 0;
+        // Time from the command to the driver reporting the move done.
+        int64_t lastLatencyNs = -1;
+        int64_t totalLatencyNs = 0;
+        int64_t maxLatencyNs = 0;
+        // When the move in progress was commanded, 0 if none.
+        int64_t pendingSinceNs = 0;
+    };
+
+    //! Find the input device reporting the motor events.
+    void openEventDevice();
+    void readEvents();
+    void handleEvent(int code, int64_t timestampNs);
+    //! Drop stale moves and, without motor events, read the position node.
+    void refreshState(int64_t nowNs);
+    void setState(MotorState state, int64_t nowNs);
+    void completeMove(bool up, bool blocked, int64_t timestampNs);
+
+    android::base::unique_fd mDirectionFd;
+    android::base::unique_fd mEnableFd;
+    android::base::unique_fd mPositionFd;
+    android::base::unique_fd mEventFd;
+    std::string mEventDevice;
+    // Whether the events carry CLOCK_MONOTONIC timestamps.
+    bool mEventTimestamps = false;
+
+    std::mutex mMutex;
+    MotorState mState = MotorState::UNKNOWN;
+    int64_t mStateSinceNs = 0;
+    // Indexed by direction, 0 down and 1 up.
+    MoveStats mMoves[2];
+};
+
+}  // namespace oplus_motor
+}  // namespace lineage
+}  // namespace vendor
+}  // namespace aidl
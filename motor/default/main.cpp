@@ -0,0 +1,26 @@
+/*
+ * Copyright (C) 2024 The LineageOS Project
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "CameraMotor.h"
+
+#include <android-base/logging.h>
+#include <android/binder_manager.h>
+#include <android/binder_process.h>
+
+using ::aidl::vendor::lineage::oplus_motor::CameraMotor;
+
+int main() {
+    ABinderProcess_setThreadPoolMaxThreadCount(0);
+    ABinderProcess_startThreadPool();
+    std::shared_ptr<CameraMotor> motor = ndk::SharedRefBase::make<CameraMotor>();
+
+    const std::string instance = std::string(CameraMotor::descriptor) + "/default";
+    binder_status_t status = AServiceManager_addService(motor->asBinder().get(), instance.c_str());
+    CHECK_EQ(status, STATUS_OK);
+
+    ABinderProcess_joinThreadPool();
+    return EXIT_FAILURE;  // should not reach
+}
@@ -0,0 +1,176 @@
+/*
+ * Copyright (C) 2024 The LineageOS Project
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "PowerHintConfig.h"
+
+#include <json/reader.h>
+#include <json/value.h>
+
+#include <algorithm>
+#include <map>
+#include <set>
+
+namespace powerhint {
+
+static bool fail(std::string* error, const std::string& message) {
+    *error = message;
+    return false;
+}
+
+static bool parseNodes(const Json::Value& root, PowerHintConfig* config, std::string* error) {
+    const Json::Value& nodes = root["Nodes"];
+    if (!nodes.isArray() || nodes.empty()) {
+        return fail(error, "no Nodes");
+    }
+
+    std::set<std::string> names, paths;
+    for (Json::ArrayIndex i = 0; i < nodes.size(); i++) {
+        const Json::Value& node = nodes[i];
+        std::string where = "Nodes[" + std::to_string(i) + "]";
+        NodeConfig out;
+
+        if (!node.isObject()) {
+            return fail(error, where + ": must be an object");
+        }
+        if (!node["Name"].isString() || node["Name"].asString().empty()) {
+            return fail(error, where + ": Name must be a non-empty string");
+        }
+        out.name = node["Name"].asString();
+        where += " (" + out.name + ")";
+        if (!names.insert(out.name).second) {
+            return fail(error, where + ": duplicate Name");
+        }
+
+        if (!node["Path"].isString() || node["Path"].asString().empty()) {
+            return fail(error, where + ": Path must be a non-empty string");
+        }
+        out.path = node["Path"].asString();
+        if (!paths.insert(out.path).second) {
+            return fail(error, where + ": duplicate Path");
+        }
+
+        const Json::Value& values = node["Values"];
+        if (!values.isArray() || values.empty()) {
+            return fail(error, where + ": Values must be a non-empty array");
+        }
+        std::set<std::string> seen;
+        for (const Json::Value& value : values) {
+            if (!value.isString()) {
+                return fail(error, where + ": Values must be strings");
+            }
+            if (!seen.insert(value.asString()).second) {
+                return fail(error, where + ": duplicate value " + value.asString());
+            }
+            out.values.push_back(value.asString());
+        }
+        if (out.values.size() > UINT16_MAX) {
+            return fail(error, where + ": too many Values");
+        }
+
+        const Json::Value& typeValue = node.get("Type", "File");
+        if (!typeValue.isString()) {
+            return fail(error, where + ": Type must be a string");
+        }
+        std::string type = typeValue.asString();
+        if (type != "File" && type != "Property") {
+            return fail(error, where + ": unknown Type " + type);
+        }
+        out.isProperty = type == "Property";
+
+        const Json::Value& defaultIndex = node["DefaultIndex"];
+        if (defaultIndex.isNull()) {
+            out.defaultIndex = 0;
+        } else if (!defaultIndex.isUInt() || defaultIndex.asUInt() >= out.values.size()) {
+            return fail(error, where + ": DefaultIndex out of range");
+        } else {
+            out.defaultIndex = defaultIndex.asUInt();
+        }
+
+        if (!node.get("ResetOnInit", false).isBool() || !node.get("HoldFd", false).isBool()) {
+            return fail(error, where + ": ResetOnInit and HoldFd must be booleans");
+        }
+        out.resetOnInit = node.get("ResetOnInit", false).asBool();
+        out.holdFd = node.get("HoldFd", false).asBool();
+        if (out.isProperty && out.holdFd) {
+            return fail(error, where + ": HoldFd is not supported for properties");
+        }
+
+        config->nodes.push_back(std::move(out));
+    }
+    return true;
+}
+
+static bool parseActions(const Json::Value& root, PowerHintConfig* config, std::string* error) {
+    const Json::Value& actions = root["Actions"];
+    if (!actions.isArray()) {
+        return fail(error, "no Actions");
+    }
+
+    std::map<std::string, uint32_t> nodeIndex;
+    for (uint32_t i = 0; i < config->nodes.size(); i++) {
+        nodeIndex[config->nodes[i].name] = i;
+    }
+
+    std::set<std::pair<std::string, uint32_t>> seen;
+    for (Json::ArrayIndex i = 0; i < actions.size(); i++) {
+        const Json::Value& action = actions[i];
+        std::string where = "Actions[" + std::to_string(i) + "]";
+        ActionConfig out;
+
+        if (!action.isObject()) {
+            return fail(error, where + ": must be an object");
+        }
+        if (!action["PowerHint"].isString() || action["PowerHint"].asString().empty()) {
+            return fail(error, where + ": PowerHint must be a non-empty string");
+        }
+        out.hint = action["PowerHint"].asString();
+        where += " (" + out.hint + ")";
+
+        if (!action["Node"].isString()) {
+            return fail(error, where + ": Node must be a string");
+        }
+        auto node = nodeIndex.find(action["Node"].asString());
+        if (node == nodeIndex.end()) {
+            return fail(error, where + ": unknown Node " + action["Node"].asString());
+        }
+        out.node = node->second;
+        if (!seen.insert({out.hint, out.node}).second) {
+            return fail(error, where + ": more than one action on " + node->first);
+        }
+
+        const NodeConfig& target = config->nodes[out.node];
+        if (!action["Value"].isString()) {
+            return fail(error, where + ": Value must be a string");
+        }
+        std::string value = action["Value"].asString();
+        auto it = std::find(target.values.begin(), target.values.end(), value);
+        if (it == target.values.end()) {
+            return fail(error, where + ": Value " + value + " is not one of " + target.name +
+                                       "'s Values");
+        }
+        out.valueIndex = it - target.values.begin();
+
+        if (!action["Duration"].isUInt()) {
+            return fail(error, where + ": Duration must be a non-negative integer");
+        }
+        out.durationMs = action["Duration"].asUInt();
+
+        config->actions.push_back(std::move(out));
+    }
+    return true;
+}
+
+bool ParsePowerHintConfig(const std::string& json, PowerHintConfig* config, std::string* error) {
+    Json::Value root;
+    Json::Reader reader;
+    if (!reader.parse(json, root) || !root.isObject()) {
+        return fail(error, "failed to parse JSON: " + reader.getFormattedErrorMessages());
+    }
+    *config = {};
+    return parseNodes(root, config, error) && parseActions(root, config, error);
+}
+
+}  // namespace powerhint
@@ -0,0 +1,47 @@
+/*
+ * Copyright (C) 2024 The LineageOS Project
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace powerhint {
+
+struct NodeConfig {
+    std::string name;
+    std::string path;
+    // Ordered by priority, a lower index wins over a higher one.
+    std::vector<std::string> values;
+    uint32_t defaultIndex;
+    bool resetOnInit;
+    bool holdFd;
+    bool isProperty;
+};
+
+struct ActionConfig {
+    std::string hint;
+    uint32_t node;
+    uint32_t valueIndex;
+    // 0 keeps the request until the hint is ended.
+    uint32_t durationMs;
+};
+
+struct PowerHintConfig {
+    std::vector<NodeConfig> nodes;
+    std::vector<ActionConfig> actions;
+};
+
+/*
+ * Parse a libperfmgr powerhint.json, applying the same checks the power HAL does when it loads
+ * the file, so that a config that would be rejected on device fails the build instead.
+ *
+ * @return false with a description in error if the config is invalid.
+ */
+bool ParsePowerHintConfig(const std::string& json, PowerHintConfig* config, std::string* error);
+
+}  // namespace powerhint
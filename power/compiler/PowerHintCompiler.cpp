@@ -0,0 +1,44 @@
+/*
+ * Copyright (C) 2024 The LineageOS Project
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * Validates powerhint.json with the checks the power HAL applies when it loads the file.
+ *
+ * Usage: powerhint_compiler <powerhint.json>
+ *
+ * The build runs it on the powerhint.json it ships, so a config the power HAL in hardware/oplus
+ * would reject on device fails the build instead.
+ */
+
+#include "PowerHintConfig.h"
+
+#include <android-base/file.h>
+
+#include <cstdio>
+
+using android::base::ReadFileToString;
+
+int main(int argc, char** argv) {
+    using namespace powerhint;
+
+    if (argc != 2) {
+        fprintf(stderr, "Usage: %s <powerhint.json>\n", argv[0]);
+        return 1;
+    }
+
+    std::string json;
+    if (!ReadFileToString(argv[1], &json)) {
+        fprintf(stderr, "%s: failed to read\n", argv[1]);
+        return 1;
+    }
+    PowerHintConfig config;
+    std::string error;
+    if (!ParsePowerHintConfig(json, &config, &error)) {
+        fprintf(stderr, "%s: %s\n", argv[1], error.c_str());
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,469 @@
+/*
+ * Copyright (C) 2024 The LineageOS Project
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * Replays a power hint timeline against powerhint.json and a fake sysfs tree.
+ *
+ * Usage: powerhint_simulator [--root <dir>] [--quiet] <powerhint.json> <timeline>
+ *
+ * Node values are resolved the way libperfmgr does it: every hint holds a request for one value
+ * index on each node it has an action for, the lowest requested index wins, and the node falls
+ * back to its DefaultIndex once no request is left. A DoHint duration of 0 uses the Duration of
+ * each action, an action Duration of 0 holds the request until EndHint, and repeating a hint
+ * only ever extends its requests. A node is written only when its effective index changes, and
+ * ResetOnInit nodes are written once at start.
+ *
+ * File nodes are written below <root> (a new directory in /tmp by default, removed on exit), so
+ * /sys and /dev/stune paths land in e.g. /tmp/powerhint_sim.XXXXXX/sys/... Property nodes are
+ * written to <root>/properties/<name>. Existing files under --root are used as the initial node
+ * contents, e.g. a copy of the device's nodes taken with adb.
+ *
+ * Timeline lines, times in milliseconds from the start, '#' starts a comment:
+ *   <time> do <hint> [<duration>] [repeat <count> <interval>]
+ *   <time> end <hint>
+ *   <time> dump
+ */
+
+#include "PowerHintConfig.h"
+
+#include <android-base/file.h>
+#include <android-base/parseint.h>
+#include <android-base/stringprintf.h>
+#include <android-base/strings.h>
+#include <android-base/unique_fd.h>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <map>
+
+using android::base::ParseInt;
+using android::base::ParseUint;
+using android::base::ReadFileToString;
+using android::base::unique_fd;
+
+namespace powerhint {
+
+static constexpr int64_t kForever = INT64_MAX;
+
+struct TimelineEvent {
+    enum Type { kDo, kEnd, kDump } type = kDo;
+    int64_t timeMs = 0;
+    std::string hint;
+    uint32_t durationMs = 0;
+    // Line in the timeline, for messages.
+    size_t line = 0;
+};
+
+static bool parseTimeline(const std::string& text, std::vector<TimelineEvent>* events,
+                          std::string* error) {
+    std::vector<std::string> lines = android::base::Split(text, "\n");
+    for (size_t i = 0; i < lines.size(); i++) {
+        std::string line = android::base::Trim(lines[i].substr(0, lines[i].find('#')));
+        if (line.empty()) {
+            continue;
+        }
+        std::vector<std::string> words;
+        for (const std::string& word : android::base::Split(line, " \t")) {
+            if (!word.empty()) words.push_back(word);
+        }
+
+        TimelineEvent event;
+        event.line = i + 1;
+        uint32_t count = 1, intervalMs = 0;
+        bool ok = words.size() >= 2 && ParseInt(words[0], &event.timeMs, int64_t{0});
+        if (ok && words[1] == "do" && words.size() >= 3) {
+            event.type = TimelineEvent::kDo;
+            event.hint = words[2];
+            size_t next = 3;
+            if (next < words.size() && words[next] != "repeat") {
+                ok = ParseUint(words[next++], &event.durationMs);
+            }
+            if (ok && next < words.size()) {
+                ok = words.size() == next + 3 && words[next] == "repeat" &&
+                     ParseUint(words[next + 1], &count) && count > 0 &&
+                     ParseUint(words[next + 2], &intervalMs);
+            }
+        } else if (ok && words[1] == "end" && words.size() == 3) {
+            event.type = TimelineEvent::kEnd;
+            event.hint = words[2];
+        } else if (ok && words[1] == "dump" && words.size() == 2) {
+            event.type = TimelineEvent::kDump;
+        } else {
+            ok = false;
+        }
+        if (!ok) {
+            *error = "line " + std::to_string(i + 1) + ": cannot parse '" + line + "'";
+            return false;
+        }
+
+        for (uint32_t n = 0; n < count; n++) {
+            events->push_back(event);
+            event.timeMs += intervalMs;
+        }
+    }
+    std::stable_sort(events->begin(), events->end(),
+                     [](const TimelineEvent& a, const TimelineEvent& b) {
+                         return a.timeMs < b.timeMs;
+                     });
+    return true;
+}
+
+class Simulator {
+  public:
+    Simulator(const PowerHintConfig& config, const std::string& root, bool quiet)
+        : mConfig(config), mRoot(root), mQuiet(quiet), mNodes(config.nodes.size()) {
+        for (uint32_t i = 0; i < mConfig.actions.size(); i++) {
+            mHintActions[mConfig.actions[i].hint].push_back(i);
+        }
+    }
+
+    // Seed the fake tree with each node's default value and apply ResetOnInit.
+    bool init() {
+        for (uint32_t i = 0; i < mNodes.size(); i++) {
+            const NodeConfig& config = mConfig.nodes[i];
+            NodeState& node = mNodes[i];
+            node.file = filePath(config);
+            node.index = config.defaultIndex;
+
+            std::error_code ec;
+            std::filesystem::create_directories(std::filesystem::path(node.file).parent_path(),
+                                                ec);
+            if (!ReadFileToString(node.file, &node.contents)) {
+                node.contents = config.values[config.defaultIndex];
+                if (!android::base::WriteStringToFile(node.contents, node.file)) {
+                    fprintf(stderr, "Failed to create %s\n", node.file.c_str());
+                    return false;
+                }
+            }
+            node.contents = android::base::Trim(node.contents);
+            if (config.resetOnInit) {
+                if (!write(i, config.defaultIndex)) {
+                    return false;
+                }
+                // Keep the boot time reset out of the per node numbers.
+                node.writes = node.redundantWrites = 0;
+                mInitWrites++;
+            }
+        }
+        return true;
+    }
+
+    bool run(const std::vector<TimelineEvent>& events) {
+        for (const TimelineEvent& event : events) {
+            advanceTo(event.timeMs);
+            switch (event.type) {
+                case TimelineEvent::kDo:
+                    if (!dispatch(event, true)) return false;
+                    break;
+                case TimelineEvent::kEnd:
+                    if (!dispatch(event, false)) return false;
+                    break;
+                case TimelineEvent::kDump:
+                    dumpState(event.timeMs);
+                    break;
+            }
+        }
+        // Let every timed request run out so the report covers the restores too.
+        advanceTo(kForever - 1);
+        return true;
+    }
+
+    void report() const {
+        printf("\nHint dispatch               count  requests  absorbed  writes   avg us"
+               "   max us\n");
+        for (const auto& [name, stats] : mDispatchStats) {
+            printf("%-27s %5llu %9llu %9llu %7llu %8.1f %8.1f\n", name.c_str(),
+                   static_cast<unsigned long long>(stats.count),
+                   static_cast<unsigned long long>(stats.requests),
+                   static_cast<unsigned long long>(stats.absorbed),
+                   static_cast<unsigned long long>(stats.writes),
+                   stats.totalNs / 1000.0 / stats.count, stats.maxNs / 1000.0);
+        }
+
+        uint64_t writes = 0, redundant = 0;
+        printf("\nNode                        writes  redundant  final\n");
+        for (uint32_t i = 0; i < mNodes.size(); i++) {
+            const NodeState& node = mNodes[i];
+            writes += node.writes;
+            redundant += node.redundantWrites;
+            if (node.writes == 0) continue;
+            printf("%-27s %7llu %10llu  %s\n", mConfig.nodes[i].name.c_str(),
+                   static_cast<unsigned long long>(node.writes),
+                   static_cast<unsigned long long>(node.redundantWrites), node.contents.c_str());
+        }
+        printf("\nTotal: %llu writes, %llu redundant (value already in the node), "
+               "%llu write failures, %llu ResetOnInit writes at start\n",
+               static_cast<unsigned long long>(writes), static_cast<unsigned long long>(redundant),
+               static_cast<unsigned long long>(mWriteFailures),
+               static_cast<unsigned long long>(mInitWrites));
+    }
+
+  private:
+    struct NodeState {
+        std::string file;
+        // Last value written to or read from the file.
+        std::string contents;
+        uint32_t index;
+        // Requests by value index, each a map of hint to expiry time.
+        std::map<uint32_t, std::map<std::string, int64_t>> requests;
+        unique_fd fd;
+        uint64_t writes = 0;
+        uint64_t redundantWrites = 0;
+    };
+
+    struct DispatchStats {
+        uint64_t count = 0;
+        uint64_t requests = 0;
+        // Requests that did not change the node's effective value.
+        uint64_t absorbed = 0;
+        uint64_t writes = 0;
+        int64_t totalNs = 0;
+        int64_t maxNs = 0;
+    };
+
+    std::string filePath(const NodeConfig& config) const {
+        if (config.isProperty) {
+            return mRoot + "/properties/" + config.path;
+        }
+        return mRoot + config.path;
+    }
+
+    // The lowest requested index still active at nowMs, or the default.
+    uint32_t resolve(NodeState& node, uint32_t nodeIndex, int64_t nowMs,
+                     std::string* winner) const {
+        for (auto it = node.requests.begin(); it != node.requests.end();) {
+            auto& hints = it->second;
+            for (auto hint = hints.begin(); hint != hints.end();) {
+                hint = hint->second <= nowMs ? hints.erase(hint) : std::next(hint);
+            }
+            if (hints.empty()) {
+                it = node.requests.erase(it);
+                continue;
+            }
+            if (winner) *winner = hints.begin()->first;
+            return it->first;
+        }
+        if (winner) *winner = "default";
+        return mConfig.nodes[nodeIndex].defaultIndex;
+    }
+
+    bool write(uint32_t nodeIndex, uint32_t valueIndex) {
+        const NodeConfig& config = mConfig.nodes[nodeIndex];
+        NodeState& node = mNodes[nodeIndex];
+        const std::string& value = config.values[valueIndex];
+
+        bool ok;
+        if (config.holdFd) {
+            if (node.fd < 0) {
+                node.fd.reset(TEMP_FAILURE_RETRY(
+                        open(node.file.c_str(), O_WRONLY | O_CREAT | O_CLOEXEC, 0644)));
+            }
+            ok = node.fd >= 0 &&
+                 TEMP_FAILURE_RETRY(pwrite(node.fd, value.c_str(), value.size(), 0)) ==
+                         static_cast<ssize_t>(value.size()) &&
+                 ftruncate(node.fd, value.size()) == 0;
+        } else {
+            ok = android::base::WriteStringToFile(value, node.file);
+        }
+        if (!ok) {
+            fprintf(stderr, "Failed to write %s to %s\n", value.c_str(), node.file.c_str());
+            mWriteFailures++;
+            return false;
+        }
+
+        node.writes++;
+        if (node.contents == value) {
+            node.redundantWrites++;
+        }
+        node.contents = value;
+        node.index = valueIndex;
+        return true;
+    }
+
+    // Re-resolve the node and write it if its value changed, returns whether it was written.
+    bool update(uint32_t nodeIndex, int64_t nowMs, const char* reason) {
+        NodeState& node = mNodes[nodeIndex];
+        std::string winner;
+        uint32_t index = resolve(node, nodeIndex, nowMs, &winner);
+        if (index == node.index) {
+            return false;
+        }
+        const NodeConfig& config = mConfig.nodes[nodeIndex];
+        std::string old = config.values[node.index];
+        if (!write(nodeIndex, index)) {
+            return false;
+        }
+        if (!mQuiet) {
+            // Printed by flushChanges(), outside of the timed dispatch.
+            mChanges.push_back(android::base::StringPrintf(
+                    "%10lld ms  %-6s %-27s %s -> %s (%s)", static_cast<long long>(nowMs), reason,
+                    config.name.c_str(), old.c_str(), config.values[index].c_str(),
+                    winner.c_str()));
+        }
+        return true;
+    }
+
+    void flushChanges() {
+        for (const std::string& change : mChanges) {
+            printf("%s\n", change.c_str());
+        }
+        mChanges.clear();
+    }
+
+    bool dispatch(const TimelineEvent& event, bool start) {
+        auto actions = mHintActions.find(event.hint);
+        if (actions == mHintActions.end()) {
+            fprintf(stderr, "line %zu: %s is not in the config\n", event.line,
+                    event.hint.c_str());
+            return false;
+        }
+
+        DispatchStats& stats = mDispatchStats[(start ? "do " : "end ") + event.hint];
+        auto begin = std::chrono::steady_clock::now();
+        uint64_t failures = mWriteFailures;
+        for (uint32_t actionIndex : actions->second) {
+            const ActionConfig& action = mConfig.actions[actionIndex];
+            NodeState& node = mNodes[action.node];
+            if (start) {
+                uint32_t durationMs = event.durationMs ? event.durationMs : action.durationMs;
+                int64_t expiry = durationMs ? event.timeMs + durationMs : kForever;
+                int64_t& current = node.requests[action.valueIndex][event.hint];
+                current = std::max(current, expiry);
+            } else {
+                auto it = node.requests.find(action.valueIndex);
+                if (it != node.requests.end()) {
+                    it->second.erase(event.hint);
+                }
+            }
+            stats.requests++;
+            if (update(action.node, event.timeMs, start ? "do" : "end")) {
+                stats.writes++;
+            } else {
+                stats.absorbed++;
+            }
+        }
+        int64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                             std::chrono::steady_clock::now() - begin)
+                             .count();
+        stats.count++;
+        stats.totalNs += ns;
+        stats.maxNs = std::max(stats.maxNs, ns);
+        flushChanges();
+        return mWriteFailures == failures;
+    }
+
+    // Expire requests in time order up to and including nowMs.
+    void advanceTo(int64_t nowMs) {
+        while (true) {
+            int64_t next = kForever;
+            for (const NodeState& node : mNodes) {
+                for (const auto& [index, hints] : node.requests) {
+                    for (const auto& [hint, expiry] : hints) {
+                        next = std::min(next, expiry);
+                    }
+                }
+            }
+            if (next > nowMs) {
+                return;
+            }
+            for (uint32_t i = 0; i < mNodes.size(); i++) {
+                update(i, next, "expire");
+            }
+            flushChanges();
+        }
+    }
+
+    void dumpState(int64_t nowMs) {
+        printf("%10lld ms  state:\n", static_cast<long long>(nowMs));
+        for (uint32_t i = 0; i < mNodes.size(); i++) {
+            std::string winner;
+            resolve(mNodes[i], i, nowMs, &winner);
+            printf("              %-27s %-12s %s\n", mConfig.nodes[i].name.c_str(),
+                   mNodes[i].contents.c_str(), winner.c_str());
+        }
+    }
+
+    const PowerHintConfig& mConfig;
+    const std::string mRoot;
+    const bool mQuiet;
+    std::vector<NodeState> mNodes;
+    std::map<std::string, std::vector<uint32_t>> mHintActions;
+    std::map<std::string, DispatchStats> mDispatchStats;
+    std::vector<std::string> mChanges;
+    uint64_t mWriteFailures = 0;
+    uint64_t mInitWrites = 0;
+};
+
+}  // namespace powerhint
+
+int main(int argc, char** argv) {
+    using namespace powerhint;
+
+    std::string root;
+    bool quiet = false;
+    int arg = 1;
+    for (; arg < argc && argv[arg][0] == '-'; arg++) {
+        if (!strcmp(argv[arg], "--root") && arg + 1 < argc) {
+            root = argv[++arg];
+        } else if (!strcmp(argv[arg], "--quiet")) {
+            quiet = true;
+        } else {
+            break;
+        }
+    }
+    if (argc - arg != 2) {
+        fprintf(stderr, "Usage: %s [--root <dir>] [--quiet] <powerhint.json> <timeline>\n",
+                argv[0]);
+        return 1;
+    }
+
+    std::string json, timeline, error;
+    if (!ReadFileToString(argv[arg], &json) || !ReadFileToString(argv[arg + 1], &timeline)) {
+        fprintf(stderr, "Failed to read %s or %s\n", argv[arg], argv[arg + 1]);
+        return 1;
+    }
+    PowerHintConfig config;
+    if (!ParsePowerHintConfig(json, &config, &error)) {
+        fprintf(stderr, "%s: %s\n", argv[arg], error.c_str());
+        return 1;
+    }
+    std::vector<TimelineEvent> events;
+    if (!parseTimeline(timeline, &events, &error)) {
+        fprintf(stderr, "%s: %s\n", argv[arg + 1], error.c_str());
+        return 1;
+    }
+
+    bool temporary = root.empty();
+    if (temporary) {
+        char dir[] = "/tmp/powerhint_sim.XXXXXX";
+        if (!mkdtemp(dir)) {
+            perror("mkdtemp");
+            return 1;
+        }
+        root = dir;
+    }
+
+    int ret = 1;
+    {
+        Simulator simulator(config, root, quiet);
+        if (simulator.init() && simulator.run(events)) {
+            simulator.report();
+            ret = 0;
+        }
+    }
+    if (temporary) {
+        std::error_code ec;
+        std::filesystem::remove_all(root, ec);
+    }
+    return ret;
+}
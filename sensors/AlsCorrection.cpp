@@ -7,19 +7,28 @@
 #include "AlsCorrection.h"
 
 #include <android-base/properties.h>
+#include <android-base/unique_fd.h>
 #include <android/binder_manager.h>
 #include <binder/IBinder.h>
 #include <binder/IServiceManager.h>
 #include <binder/ProcessState.h>
+#include <cstdlib>
 #include <cutils/properties.h>
+#include <fcntl.h>
 #include <fstream>
 #include <log/log.h>
+#include <mutex>
 #include <string>
 #include <sstream>
 #include <time.h>
+#include <unistd.h>
+#include <utils/SystemClock.h>
 
+using aidl::vendor::lineage::oplus_als::AreaRegionCaptureResult;
 using aidl::vendor::lineage::oplus_als::AreaRgbCaptureResult;
+using android::base::GetIntProperty;
 using android::base::GetProperty;
+using android::base::unique_fd;
 
 #define ALS_CALI_DIR "/proc/sensor/als_cali/"
 #define BRIGHTNESS_DIR "/sys/class/backlight/panel0-backlight/"
@@ -33,6 +42,20 @@ namespace implementation {
 static int red_max_lux, green_max_lux, blue_max_lux, white_max_lux, max_brightness;
 static int als_bias;
 static std::shared_ptr<IAreaCapture> service;
+// Version 2 services average several regions from one capture.
+static bool use_regions;
+static bool initialized;
+
+// Panel state, read on every light event, and the minimum time between two captures.
+static unique_fd brightness_fd, bl_power_fd;
+static int64_t min_capture_interval_ns;
+
+static std::mutex readout_mutex;
+static AreaRgbCaptureResult rgb_readout;
+// 0 while the screen is off, so that the first event after it turns on captures.
+static int64_t last_capture_ns;
+static uint64_t captures, capture_failures, skipped_panel_off, skipped_brightness_zero,
+        reused_rate_limited;
 
 template <typename T>
 static T get(const std::string& path, const T& def) {
@@ -43,9 +66,20 @@ static T get(const std::string& path, const T& def) {
     return file.fail() ? def : result;
 }
 
+static int readInt(const unique_fd& fd, int def) {
+    char buf[16];
+    ssize_t len = fd < 0 ? -1 : TEMP_FAILURE_RETRY(pread(fd, buf, sizeof(buf) - 1, 0));
+    if (len <= 0) {
+        return def;
+    }
+    buf[len] = '\0';
+    return atoi(buf);
+}
+
 void AlsCorrection::init() {
     std::istringstream is;
 
+    initialized = true;
     is = std::istringstream(GetProperty("vendor.sensors.als_correction.bias", ""));
     is >> als_bias;
     red_max_lux = get(ALS_CALI_DIR "red_max_lux", 0);
@@ -53,6 +87,12 @@ void AlsCorrection::init() {
     blue_max_lux = get(ALS_CALI_DIR "blue_max_lux", 0);
     white_max_lux = get(ALS_CALI_DIR "white_max_lux", 0);
     max_brightness = get(BRIGHTNESS_DIR "max_brightness", 1023);
+    brightness_fd.reset(
+            TEMP_FAILURE_RETRY(open(BRIGHTNESS_DIR "brightness", O_RDONLY | O_CLOEXEC)));
+    bl_power_fd.reset(TEMP_FAILURE_RETRY(open(BRIGHTNESS_DIR "bl_power", O_RDONLY | O_CLOEXEC)));
+    int max_capture_hz =
+            GetIntProperty("vendor.sensors.als_correction.max_capture_hz", 10, 0, 1000);
+    min_capture_interval_ns = max_capture_hz > 0 ? 1000000000LL / max_capture_hz : 0;
     ALOGV("Display maximums: R=%d G=%d B=%d W=%d",
         red_max_lux, green_max_lux, blue_max_lux, white_max_lux);
 
@@ -62,6 +102,8 @@ void AlsCorrection::init() {
         ALOGE("Service not found");
         return;
     }
+    int32_t version;
+    use_regions = service->getInterfaceVersion(&version).isOk() && version >= 2;
 }
 
 std::shared_ptr<IAreaCapture> AlsCorrection::getCaptureService() {
@@ -76,20 +118,80 @@ std::shared_ptr<IAreaCapture> AlsCorrection::getCaptureService() {
     return IAreaCapture::fromBinder(binder);
 }
 
-void AlsCorrection::correct(float& light) {
-    static AreaRgbCaptureResult rgb_readout;
-    AreaRgbCaptureResult new_values = {.r = 0.0f, .g = 0.0f, .b = 0.0f};
+/*
+ * Weighted average of the regions the capture service is configured with, e.g. the area above
+ * the sensor and a guard band around it, all taken from a single capture.
+ */
+static bool getRegionsBrightness(const std::shared_ptr<IAreaCapture>& service,
+                                 AreaRgbCaptureResult* result) {
+    std::vector<AreaRegionCaptureResult> regions;
+    if (!service->getRegionsBrightness(&regions).isOk()) {
+        return false;
+    }
+    float weights = 0.0f;
+    *result = {.r = 0.0f, .g = 0.0f, .b = 0.0f};
+    for (const AreaRegionCaptureResult& region : regions) {
+        ALOGV("Region %s: %f, %f, %f", region.name.c_str(), region.rgb.r, region.rgb.g,
+              region.rgb.b);
+        result->r += region.rgb.r * region.weight;
+        result->g += region.rgb.g * region.weight;
+        result->b += region.rgb.b * region.weight;
+        weights += region.weight;
+    }
+    if (weights <= 0.0f) {
+        return false;
+    }
+    result->r /= weights;
+    result->g /= weights;
+    result->b /= weights;
+    return true;
+}
 
-    if (service != nullptr && service->getAreaBrightness(&new_values).isOk()) {
-        rgb_readout = new_values;        
+/*
+ * Capture the area above the sensor, unless the screen cannot contribute light or the last
+ * capture is recent enough to be reused. Returns the brightness the correction is scaled by.
+ */
+static int updateReadout(const std::shared_ptr<IAreaCapture>& service) {
+    // FB_BLANK_UNBLANK is 0, anything else means the panel is powered down.
+    if (readInt(bl_power_fd, 0) != 0) {
+        skipped_panel_off++;
+        last_capture_ns = 0;
+        return 0;
+    }
+    int screen_brightness = readInt(brightness_fd, 0);
+    if (screen_brightness == 0) {
+        skipped_brightness_zero++;
+        last_capture_ns = 0;
+        return 0;
+    }
+
+    int64_t now = elapsedRealtimeNano();
+    if (last_capture_ns != 0 && now - last_capture_ns < min_capture_interval_ns) {
+        reused_rate_limited++;
+        return screen_brightness;
+    }
+
+    AreaRgbCaptureResult new_values = {.r = 0.0f, .g = 0.0f, .b = 0.0f};
+    captures++;
+    last_capture_ns = now;
+    if (service != nullptr && (use_regions ? getRegionsBrightness(service, &new_values)
+                                           : service->getAreaBrightness(&new_values).isOk())) {
+        rgb_readout = new_values;
     } else {
+        capture_failures++;
         ALOGE("Could not get area above sensor, falling back");
     }
+    return screen_brightness;
+}
+
+void AlsCorrection::correct(float& light) {
+    // Called from the posting sub-HAL thread, not under the event queue lock.
+    std::lock_guard<std::mutex> lock(readout_mutex);
+    int screen_brightness = updateReadout(service);
 
     float r = rgb_readout.r / 255, g = rgb_readout.g / 255, b = rgb_readout.b / 255;
     ALOGV("Screen Color Above Sensor: %f, %f, %f", r, g, b);
     ALOGV("Original reading: %f", light);
-    int screen_brightness = get(BRIGHTNESS_DIR "brightness", 0);
     float correction = 0.0f, correction_scaled = 0.0f;
     if (red_max_lux > 0 && green_max_lux > 0 && blue_max_lux > 0 && white_max_lux > 0) {
         float rgb_min = std::min({r, g, b});
@@ -122,6 +224,22 @@ void AlsCorrection::correct(float& light) {
     ALOGV("Corrected reading: %f", light);
 }
 
+void AlsCorrection::dump(std::ostream& stream) {
+    if (!initialized) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(readout_mutex);
+    stream << "ALS correction:" << std::endl;
+    stream << "  Captures: " << captures << ", failed: " << capture_failures
+           << ", max rate: "
+           << (min_capture_interval_ns > 0 ? 1000000000LL / min_capture_interval_ns : 0)
+           << " Hz" << std::endl;
+    stream << "  Skipped: panel off " << skipped_panel_off << ", brightness 0 "
+           << skipped_brightness_zero << ", reused while rate limited " << reused_rate_limited
+           << std::endl;
+}
+
 }  // namespace implementation
 }  // namespace V2_1
 }  // namespace sensors
@@ -8,6 +8,8 @@
 
 #include <aidl/vendor/lineage/oplus_als/BnAreaCapture.h>
 
+#include <ostream>
+
 using aidl::vendor::lineage::oplus_als::IAreaCapture;
 
 namespace android {
@@ -22,6 +24,7 @@ class AlsCorrection {
   public:
     static void init();
     static void correct(float& light);
+    static void dump(std::ostream& stream);
 
   private:
     static std::shared_ptr<IAreaCapture> getCaptureService();
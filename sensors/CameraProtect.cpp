@@ -0,0 +1,116 @@
+/*
+ * Copyright (C) 2024 The LineageOS Project
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "CameraProtect.h"
+
+#include <android-base/properties.h>
+#include <android-base/unique_fd.h>
+#include <log/log.h>
+#include <utils/SystemClock.h>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cinttypes>
+#include <mutex>
+
+using android::base::GetBoolProperty;
+using android::base::unique_fd;
+
+#define MOTOR_DIR "/sys/class/motor/"
+
+namespace android {
+namespace hardware {
+namespace sensors {
+namespace V2_1 {
+namespace implementation {
+
+// Must match CameraMotorController
+static constexpr char kDirectionDown = '0';
+static constexpr char kEnabled = '1';
+static constexpr char kPositionDown = '1';
+
+int32_t CameraProtect::sSensorHandle = -1;
+
+static unique_fd direction_fd, enable_fd, position_fd;
+
+static std::mutex stats_mutex;
+static uint64_t falls, retracts, already_down, failures;
+static int64_t last_latency_ns, max_latency_ns, last_write_ns;
+
+void CameraProtect::init(int32_t sensorHandle) {
+    if (!GetBoolProperty("vendor.sensors.proxy.camera_reflex", false)) {
+        ALOGV("Camera protect reflex disabled");
+        return;
+    }
+
+    direction_fd.reset(TEMP_FAILURE_RETRY(open(MOTOR_DIR "direction", O_WRONLY | O_CLOEXEC)));
+    enable_fd.reset(TEMP_FAILURE_RETRY(open(MOTOR_DIR "enable", O_WRONLY | O_CLOEXEC)));
+    position_fd.reset(TEMP_FAILURE_RETRY(open(MOTOR_DIR "position", O_RDONLY | O_CLOEXEC)));
+    if (direction_fd < 0 || enable_fd < 0 || position_fd < 0) {
+        ALOGE("Failed to open camera motor nodes, camera protect reflex disabled");
+        return;
+    }
+
+    ALOGI("Camera protect reflex enabled for sensor handle %" PRId32, sensorHandle);
+    sSensorHandle = sensorHandle;
+}
+
+void CameraProtect::onFall(Event& event) {
+    if (event.u.data[0] <= 0) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(stats_mutex);
+    falls++;
+
+    // We shouldn't really bother doing anything if motor is already closed
+    char position;
+    if (TEMP_FAILURE_RETRY(pread(position_fd, &position, 1, 0)) == 1 &&
+        position == kPositionDown) {
+        already_down++;
+        return;
+    }
+
+    int64_t start = elapsedRealtimeNano();
+    if (TEMP_FAILURE_RETRY(pwrite(direction_fd, &kDirectionDown, 1, 0)) != 1 ||
+        TEMP_FAILURE_RETRY(pwrite(enable_fd, &kEnabled, 1, 0)) != 1) {
+        ALOGE("Failed to retract camera on fall");
+        failures++;
+        return;
+    }
+    int64_t end = elapsedRealtimeNano();
+
+    retracts++;
+    last_write_ns = end - start;
+    // Sensor timestamps share the elapsedRealtime time base.
+    last_latency_ns = end - event.timestamp;
+    max_latency_ns = std::max(max_latency_ns, last_latency_ns);
+    event.u.data[1] = kRetractedByHal;
+    ALOGI("Fall detected, camera retracted %" PRId64 " us after the event",
+          last_latency_ns / 1000);
+}
+
+void CameraProtect::dump(std::ostream& stream) {
+    if (sSensorHandle == -1) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(stats_mutex);
+    stream << "Camera protect reflex:" << std::endl;
+    stream << "  Falls: " << falls << ", retracts: " << retracts
+           << ", already down: " << already_down << ", failures: " << failures << std::endl;
+    stream << "  Event to retract latency: last " << last_latency_ns / 1000 << " us, max "
+           << max_latency_ns / 1000 << " us" << std::endl;
+    stream << "  Motor write time: last " << last_write_ns / 1000 << " us" << std::endl;
+}
+
+}  // namespace implementation
+}  // namespace V2_1
+}  // namespace sensors
+}  // namespace hardware
+}  // namespace android
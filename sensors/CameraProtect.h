@@ -0,0 +1,60 @@
+/*
+ * Copyright (C) 2024 The LineageOS Project
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <android/hardware/sensors/2.1/types.h>
+
+#include <ostream>
+
+namespace android {
+namespace hardware {
+namespace sensors {
+namespace V2_1 {
+namespace implementation {
+
+static constexpr char kCameraProtectSensorType[] = "camera_protect";
+
+/**
+ * Reflex path for the pop-up camera free-fall protection. When enabled through
+ * vendor.sensors.proxy.camera_reflex, a positive camera_protect event retracts the motor right
+ * from the HAL through pre-opened sysfs nodes instead of waiting for OnePlusCameraHelper to
+ * get scheduled. The event is still forwarded so the app can show its dialog.
+ */
+class CameraProtect {
+  public:
+    /**
+     * Open the motor nodes for the given camera_protect sensor.
+     *
+     * @param sensorHandle The proxy sensor handle of the camera_protect sensor.
+     */
+    static void init(int32_t sensorHandle);
+
+    /**
+     * Retract the camera if the event reports a fall. If the motor was moved, data[1] of the
+     * event is set to kRetractedByHal so that the app skips its own motor writes.
+     */
+    static inline void process(Event& event) {
+        if (event.sensorHandle == sSensorHandle) {
+            onFall(event);
+        }
+    }
+
+    static void dump(std::ostream& stream);
+
+    static constexpr float kRetractedByHal = 1.0f;
+
+  private:
+    static void onFall(Event& event);
+
+    static int32_t sSensorHandle;
+};
+
+}  // namespace implementation
+}  // namespace V2_1
+}  // namespace sensors
+}  // namespace hardware
+}  // namespace android
@@ -0,0 +1,169 @@
+/*
+ * Copyright (C) 2024 The LineageOS Project
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "CompactEventQueue.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace android {
+namespace hardware {
+namespace sensors {
+namespace V2_1 {
+namespace implementation {
+
+static constexpr size_t kMaxPayloadWords = sizeof(Event::u) / sizeof(uint32_t);
+static_assert(sizeof(Event::u) % sizeof(uint32_t) == 0, "unexpected event payload size");
+
+size_t CompactEventQueue::payloadWords(SensorType type) {
+    switch (type) {
+        // u.scalar
+        case SensorType::LIGHT:
+        case SensorType::PRESSURE:
+        case SensorType::PROXIMITY:
+        case SensorType::RELATIVE_HUMIDITY:
+        case SensorType::AMBIENT_TEMPERATURE:
+        case SensorType::SIGNIFICANT_MOTION:
+        case SensorType::STEP_DETECTOR:
+        case SensorType::TILT_DETECTOR:
+        case SensorType::WAKE_GESTURE:
+        case SensorType::GLANCE_GESTURE:
+        case SensorType::PICK_UP_GESTURE:
+        case SensorType::WRIST_TILT_GESTURE:
+        case SensorType::DEVICE_ORIENTATION:
+        case SensorType::STATIONARY_DETECT:
+        case SensorType::MOTION_DETECT:
+        case SensorType::LOW_LATENCY_OFFBODY_DETECT:
+        case SensorType::HINGE_ANGLE:
+            return 1;
+        // u.stepCount, u.heartRate
+        case SensorType::STEP_COUNTER:
+        case SensorType::HEART_RATE:
+            return 2;
+        // u.vec3, the status byte shares the fourth word
+        case SensorType::ACCELEROMETER:
+        case SensorType::MAGNETIC_FIELD:
+        case SensorType::ORIENTATION:
+        case SensorType::GYROSCOPE:
+        case SensorType::GRAVITY:
+        case SensorType::LINEAR_ACCELERATION:
+        // u.vec4
+        case SensorType::GAME_ROTATION_VECTOR:
+            return 4;
+        // u.vec4 plus the heading accuracy in u.data[4]
+        case SensorType::ROTATION_VECTOR:
+        case SensorType::GEOMAGNETIC_ROTATION_VECTOR:
+            return 5;
+        // u.uncal
+        case SensorType::MAGNETIC_FIELD_UNCALIBRATED:
+        case SensorType::GYROSCOPE_UNCALIBRATED:
+        case SensorType::ACCELEROMETER_UNCALIBRATED:
+            return 6;
+        default:
+            return kMaxPayloadWords;
+    }
+}
+
+size_t CompactEventQueue::batchBytes(const Batch& batch) const {
+    return batch.timestamps.capacity() * sizeof(int64_t) +
+           batch.sensorHandles.capacity() * sizeof(int32_t) +
+           batch.sensorTypes.capacity() * sizeof(SensorType) +
+           batch.payload.capacity() * sizeof(uint32_t);
+}
+
+void CompactEventQueue::push(const Event* events, size_t count, size_t numWakeupEvents) {
+    if (count == 0) {
+        return;
+    }
+
+    size_t words = 0;
+    for (size_t i = 0; i < count; i++) {
+        words += payloadWords(events[i].sensorType);
+    }
+
+    Batch& batch = mBatches.emplace_back();
+    batch.numWakeupEvents = numWakeupEvents;
+    batch.timestamps.resize(count);
+    batch.sensorHandles.resize(count);
+    batch.sensorTypes.resize(count);
+    batch.payload.resize(words);
+
+    uint32_t* payload = batch.payload.data();
+    for (size_t i = 0; i < count; i++) {
+        const Event& event = events[i];
+        batch.timestamps[i] = event.timestamp;
+        batch.sensorHandles[i] = event.sensorHandle;
+        batch.sensorTypes[i] = event.sensorType;
+        size_t n = payloadWords(event.sensorType);
+        memcpy(payload, &event.u, n * sizeof(uint32_t));
+        payload += n;
+    }
+
+    mSize += count;
+    mBytes += batchBytes(batch);
+    mPeakBytes = std::max(mPeakBytes, mBytes);
+}
+
+void CompactEventQueue::peekFront(size_t maxCount, std::vector<Event>* out) const {
+    const Batch& batch = mBatches.front();
+    size_t count = std::min(maxCount, batch.timestamps.size() - batch.head);
+    out->resize(count);
+
+    const uint32_t* payload = batch.payload.data() + batch.payloadHead;
+    for (size_t i = 0; i < count; i++) {
+        size_t index = batch.head + i;
+        Event& event = (*out)[i];
+        event.timestamp = batch.timestamps[index];
+        event.sensorHandle = batch.sensorHandles[index];
+        event.sensorType = batch.sensorTypes[index];
+        size_t n = payloadWords(event.sensorType);
+        memcpy(&event.u, payload, n * sizeof(uint32_t));
+        memset(reinterpret_cast<uint32_t*>(&event.u) + n, 0,
+               (kMaxPayloadWords - n) * sizeof(uint32_t));
+        payload += n;
+    }
+}
+
+void CompactEventQueue::popFront(size_t count) {
+    Batch& batch = mBatches.front();
+    count = std::min(count, batch.timestamps.size() - batch.head);
+    for (size_t i = 0; i < count; i++) {
+        batch.payloadHead += payloadWords(batch.sensorTypes[batch.head + i]);
+    }
+    batch.head += count;
+    mSize -= count;
+    if (batch.head == batch.timestamps.size()) {
+        mBytes -= batchBytes(batch);
+        mBatches.pop_front();
+    }
+}
+
+void CompactEventQueue::clear() {
+    mBatches.clear();
+    mSize = 0;
+    mBytes = 0;
+}
+
+size_t CompactEventQueue::frontSize() const {
+    const Batch& batch = mBatches.front();
+    return batch.timestamps.size() - batch.head;
+}
+
+void CompactEventQueue::dump(std::ostream& stream) const {
+    stream << "  Pending write events: " << mSize << " in " << mBatches.size() << " batches, "
+           << mBytes << " bytes (" << mSize * sizeof(Event) << " as V2_1::Event), peak "
+           << mPeakBytes << " bytes" << std::endl;
+    if (!mBatches.empty()) {
+        stream << "  Size of events list on front of pending writes queue: " << frontSize()
+               << std::endl;
+    }
+}
+
+}  // namespace implementation
+}  // namespace V2_1
+}  // namespace sensors
+}  // namespace hardware
+}  // namespace android
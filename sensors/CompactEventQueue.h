@@ -0,0 +1,97 @@
+/*
+ * Copyright (C) 2024 The LineageOS Project
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <android/hardware/sensors/2.1/types.h>
+
+#include <deque>
+#include <ostream>
+#include <vector>
+
+namespace android {
+namespace hardware {
+namespace sensors {
+namespace V2_1 {
+namespace implementation {
+
+/**
+ * Backlog of events waiting for room in the event FMQ. A V2_1::Event is sized for its largest
+ * payload, 64 bytes, while most traffic is a 3-axis vector or a scalar. Events are stored here
+ * column by column instead: timestamp, handle and type, plus only the payload words the sensor
+ * type uses, and are expanded back to V2_1::Event right before being written to the FMQ.
+ *
+ * Events are kept in the batches they were posted in, as the writer accounts wake-up events per
+ * batch. Not thread safe, HalProxy guards it with mEventQueueWriteMutex.
+ */
+class CompactEventQueue {
+  public:
+    /**
+     * Append a batch of events.
+     *
+     * @param numWakeupEvents The number of wake-up events of the batch the events were posted in.
+     */
+    void push(const Event* events, size_t count, size_t numWakeupEvents);
+
+    /**
+     * Expand up to maxCount events from the front batch, without removing them.
+     *
+     * @param out Resized to the number of events expanded.
+     */
+    void peekFront(size_t maxCount, std::vector<Event>* out) const;
+
+    /**
+     * Remove count events from the front batch, dropping the batch once it is empty.
+     */
+    void popFront(size_t count);
+
+    void clear();
+
+    bool empty() const { return mBatches.empty(); }
+
+    //! Events in all batches.
+    size_t size() const { return mSize; }
+
+    //! Events left in the front batch.
+    size_t frontSize() const;
+
+    //! Wake-up events the front batch was posted with.
+    size_t frontWakeupEvents() const { return mBatches.front().numWakeupEvents; }
+
+    void dump(std::ostream& stream) const;
+
+    /**
+     * Number of 32-bit payload words events of the given type use. Types whose layout isn't
+     * known, e.g. vendor types, keep the whole payload.
+     */
+    static size_t payloadWords(SensorType type);
+
+  private:
+    struct Batch {
+        std::vector<int64_t> timestamps;
+        std::vector<int32_t> sensorHandles;
+        std::vector<SensorType> sensorTypes;
+        // The used payload words of every event, back to back.
+        std::vector<uint32_t> payload;
+        size_t numWakeupEvents;
+        // First event, and its first payload word, not yet written.
+        size_t head = 0;
+        size_t payloadHead = 0;
+    };
+
+    size_t batchBytes(const Batch& batch) const;
+
+    std::deque<Batch> mBatches;
+    size_t mSize = 0;
+    size_t mBytes = 0;
+    size_t mPeakBytes = 0;
+};
+
+}  // namespace implementation
+}  // namespace V2_1
+}  // namespace sensors
+}  // namespace hardware
+}  // namespace android
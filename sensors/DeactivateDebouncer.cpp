@@ -0,0 +1,238 @@
+/*
+ * Copyright (C) 2024 The LineageOS Project
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "DeactivateDebouncer.h"
+
+#include <android-base/parseint.h>
+#include <android-base/properties.h>
+#include <android-base/strings.h>
+#include <log/log.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cinttypes>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+
+using android::base::GetIntProperty;
+using android::base::GetProperty;
+using android::base::ParseInt;
+using android::base::Split;
+using android::base::Trim;
+
+namespace android {
+namespace hardware {
+namespace sensors {
+namespace V2_1 {
+namespace implementation {
+
+using std::chrono::steady_clock;
+
+namespace {
+
+struct SensorState {
+    std::string name;
+    bool onChange = false;
+    // Set while a deactivation is held back, until the deadline.
+    bool pending = false;
+    steady_clock::time_point deadline;
+    DeactivateDebouncer::Activate deactivate;
+    // The last event of an on-change sensor, replayed when a re-activation is dropped.
+    std::optional<Event> lastEvent;
+    uint64_t deferred = 0;
+    uint64_t avoided = 0;
+    uint64_t passedOn = 0;
+    uint64_t discarded = 0;
+    uint64_t replayed = 0;
+};
+
+}  // namespace
+
+static std::chrono::milliseconds window;
+
+// Only debounced sensors are added, by init(), before any event is posted.
+static std::unordered_map<int32_t, SensorState> sensor_states;
+// Taken on the event path, so never held across calls into the sub-HALs.
+static std::mutex state_mutex;
+// Taken before state_mutex around the calls into the sub-HALs, so that a deactivation being
+// passed on can't be overtaken by a re-activation.
+static std::mutex call_mutex;
+static std::condition_variable timer_cv;
+
+static void runTimer() {
+    std::unique_lock<std::mutex> lock(state_mutex);
+    while (true) {
+        steady_clock::time_point now = steady_clock::now();
+        steady_clock::time_point next = steady_clock::time_point::max();
+        int32_t dueHandle = 0;
+        bool due = false;
+        for (const auto& [sensorHandle, state] : sensor_states) {
+            if (!state.pending) {
+                continue;
+            }
+            if (state.deadline <= now) {
+                dueHandle = sensorHandle;
+                due = true;
+                break;
+            }
+            next = std::min(next, state.deadline);
+        }
+        if (!due) {
+            timer_cv.wait_until(lock, next);
+            continue;
+        }
+
+        lock.unlock();
+        {
+            std::lock_guard<std::mutex> callLock(call_mutex);
+            DeactivateDebouncer::Activate deactivate;
+            {
+                std::lock_guard<std::mutex> stateLock(state_mutex);
+                SensorState& state = sensor_states[dueHandle];
+                // Re-activated or cancelled since.
+                if (state.pending && state.deadline <= now) {
+                    state.pending = false;
+                    state.lastEvent.reset();
+                    state.passedOn++;
+                    deactivate = std::move(state.deactivate);
+                }
+            }
+            if (deactivate && deactivate(false) != V1_0::Result::OK) {
+                ALOGE("Deferred deactivation of sensor 0x%" PRIx32 " failed", dueHandle);
+            }
+        }
+        lock.lock();
+    }
+}
+
+void DeactivateDebouncer::init(const std::map<int32_t, SensorInfo>& sensors) {
+    std::unordered_set<int32_t> types;
+    for (const std::string& type :
+         Split(GetProperty("vendor.sensors.proxy.deactivate_debounce_types", ""), ",")) {
+        int32_t value;
+        if (ParseInt(Trim(type), &value)) {
+            types.insert(value);
+        } else if (!Trim(type).empty()) {
+            ALOGE("Invalid sensor type to debounce: %s", type.c_str());
+        }
+    }
+    if (types.empty()) {
+        ALOGI("Deactivate debouncing disabled");
+        return;
+    }
+    window = std::chrono::milliseconds(
+            GetIntProperty("vendor.sensors.proxy.deactivate_debounce_ms", 200, 1, 5000));
+
+    for (const auto& [sensorHandle, sensor] : sensors) {
+        uint32_t mode = sensor.flags & V1_0::SensorFlagBits::MASK_REPORTING_MODE;
+        // One-shot and special sensors have their own activation semantics.
+        if (types.count(static_cast<int32_t>(sensor.type)) == 0 ||
+            (mode != static_cast<uint32_t>(V1_0::SensorFlagBits::CONTINUOUS_MODE) &&
+             mode != static_cast<uint32_t>(V1_0::SensorFlagBits::ON_CHANGE_MODE))) {
+            continue;
+        }
+        SensorState& state = sensor_states[sensorHandle];
+        state.name = sensor.name;
+        state.onChange = mode == static_cast<uint32_t>(V1_0::SensorFlagBits::ON_CHANGE_MODE);
+    }
+    ALOGI("Deactivate debouncing for %zu sensors, window %lld ms", sensor_states.size(),
+          static_cast<long long>(window.count()));
+    if (!sensor_states.empty()) {
+        std::thread(runTimer).detach();
+    }
+}
+
+V1_0::Result DeactivateDebouncer::activate(int32_t sensorHandle, bool enabled,
+                                           const Activate& forward, std::optional<Event>* replay) {
+    auto iter = sensor_states.find(sensorHandle);
+    if (iter == sensor_states.end()) {
+        return forward(enabled);
+    }
+
+    SensorState& state = iter->second;
+    std::lock_guard<std::mutex> callLock(call_mutex);
+    {
+        std::lock_guard<std::mutex> lock(state_mutex);
+        if (enabled && state.pending) {
+            // Still on in the sub-HAL, drop both calls.
+            state.pending = false;
+            state.deactivate = nullptr;
+            state.avoided++;
+            if (state.onChange && state.lastEvent) {
+                *replay = state.lastEvent;
+                state.replayed++;
+            }
+            return V1_0::Result::OK;
+        }
+        if (!enabled) {
+            if (!state.pending) {
+                state.pending = true;
+                state.deadline = steady_clock::now() + window;
+                state.deactivate = forward;
+                state.deferred++;
+                timer_cv.notify_one();
+            }
+            return V1_0::Result::OK;
+        }
+    }
+    return forward(true);
+}
+
+void DeactivateDebouncer::cancelAll() {
+    std::lock_guard<std::mutex> callLock(call_mutex);
+    std::lock_guard<std::mutex> lock(state_mutex);
+    for (auto& [sensorHandle, state] : sensor_states) {
+        state.pending = false;
+        state.deactivate = nullptr;
+        state.lastEvent.reset();
+    }
+}
+
+bool DeactivateDebouncer::discard(const Event& event, bool wakeUp) {
+    if (event.sensorType == SensorType::META_DATA) {
+        return false;
+    }
+    auto iter = sensor_states.find(event.sensorHandle);
+    if (iter == sensor_states.end()) {
+        return false;
+    }
+
+    SensorState& state = iter->second;
+    std::lock_guard<std::mutex> lock(state_mutex);
+    if (state.onChange && event.sensorType != SensorType::ADDITIONAL_INFO) {
+        state.lastEvent = event;
+    }
+    if (!state.pending || wakeUp) {
+        return false;
+    }
+    state.discarded++;
+    return true;
+}
+
+void DeactivateDebouncer::dump(std::ostream& stream) {
+    if (sensor_states.empty()) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(state_mutex);
+    stream << "Deactivate debouncing, window " << window.count() << " ms:" << std::endl;
+    for (const auto& [sensorHandle, state] : sensor_states) {
+        stream << "  " << state.name << ": deferred " << state.deferred
+               << ", reconfigurations avoided " << state.avoided << ", passed on "
+               << state.passedOn << ", events discarded " << state.discarded << ", replayed "
+               << state.replayed << (state.pending ? ", deactivation pending" : "") << std::endl;
+    }
+}
+
+}  // namespace implementation
+}  // namespace V2_1
+}  // namespace sensors
+}  // namespace hardware
+}  // namespace android
@@ -0,0 +1,74 @@
+/*
+ * Copyright (C) 2024 The LineageOS Project
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <android/hardware/sensors/2.1/types.h>
+
+#include <functional>
+#include <map>
+#include <optional>
+#include <ostream>
+
+namespace android {
+namespace hardware {
+namespace sensors {
+namespace V2_1 {
+namespace implementation {
+
+/**
+ * Debounces deactivations. The framework often turns a sensor off and straight back on, e.g.
+ * proximity during calls or light across screen transitions, and each toggle costs the sub-HAL
+ * a firmware reconfiguration and the sensor its first-sample latency.
+ *
+ * For the sensor types listed in vendor.sensors.proxy.deactivate_debounce_types, comma separated
+ * numbers, a deactivation is held back for vendor.sensors.proxy.deactivate_debounce_ms and then
+ * passed on, unless the sensor is activated again first, in which case both calls are dropped.
+ * Meanwhile the events of non wake-up sensors are discarded, those of wake-up sensors being left
+ * alone so as not to upset the wakelock accounting. As an on-change sensor kept on has no reason
+ * to report again, its last event is handed back on re-activation for the proxy to replay.
+ */
+class DeactivateDebouncer {
+  public:
+    using Activate = std::function<V1_0::Result(bool enabled)>;
+
+    /**
+     * Pick the sensors to debounce and start the deactivation timer.
+     *
+     * @param sensors The static sensors of all sub-HALs, keyed by proxy sensor handle.
+     */
+    static void init(const std::map<int32_t, SensorInfo>& sensors);
+
+    /**
+     * Take an activate() call, deferring or dropping it if the sensor is debounced.
+     *
+     * @param forward Makes the call into the sub-HAL, later for a deferred deactivation.
+     * @param replay Set to the event to post again when a re-activation was dropped.
+     *
+     * @return The result of the call, OK when it was deferred or dropped.
+     */
+    static V1_0::Result activate(int32_t sensorHandle, bool enabled, const Activate& forward,
+                                 std::optional<Event>* replay);
+
+    /**
+     * Drop the pending deactivations, e.g. as all sensors are being disabled.
+     */
+    static void cancelAll();
+
+    /**
+     * Whether the event belongs to a sensor with a pending deactivation and is to be dropped.
+     * The event is kept as the last one of the sensor either way.
+     */
+    static bool discard(const Event& event, bool wakeUp);
+
+    static void dump(std::ostream& stream);
+};
+
+}  // namespace implementation
+}  // namespace V2_1
+}  // namespace sensors
+}  // namespace hardware
+}  // namespace android
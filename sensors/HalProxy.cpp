@@ -17,6 +17,17 @@
 #include "HalProxy.h"
 
 #include "AlsCorrection.h"
+#include "CameraProtect.h"
+#include "CompactEventQueue.h"
+#include "DeactivateDebouncer.h"
+#include "HalProxyCallback.h"
+#include "LockProfiler.h"
+#include "OnChangeFilter.h"
+#include "RateGovernor.h"
+#include "SensorListCache.h"
+#include "SensorsTrace.h"
+#include "SubHalExecutor.h"
+#include "ThreadPolicy.h"
 
 #include <android/hardware/sensors/2.0/types.h>
 
@@ -29,6 +40,7 @@
 #include <cmath>
 #include <fstream>
 #include <functional>
+#include <future>
 #include <thread>
 
 namespace android {
@@ -40,6 +52,7 @@ namespace implementation {
 using ::android::hardware::sensors::V1_0::Result;
 using ::android::hardware::sensors::V2_0::EventQueueFlagBits;
 using ::android::hardware::sensors::V2_0::WakeLockQueueFlagBits;
+using ::android::hardware::sensors::V2_0::implementation::HalProxyCallbackV2_1;
 using ::android::hardware::sensors::V2_0::implementation::getTimeNow;
 using ::android::hardware::sensors::V2_0::implementation::kWakelockTimeoutNs;
 
@@ -48,6 +61,16 @@ typedef V2_1::implementation::ISensorsSubHal*(SensorsHalGetSubHalV2_1Func)(uint3
 
 static constexpr int32_t kBitsAfterSubHalIndex = 24;
 
+//! Issues configuration calls into the sub-HALs, one ordered lane per sub-HAL.
+static SubHalExecutor sConfigExecutor;
+
+//! Events waiting for room in the event FMQ, guarded by mEventQueueWriteMutex. Replaces
+//! mPendingWriteEventsQueue, which holds full V2_1::Events.
+static CompactEventQueue sPendingEvents;
+
+//! The front of sPendingEvents expanded for the FMQ write, only used by the pending writes thread.
+static std::vector<Event> sPendingWriteBuffer;
+
 /**
  * Set the subhal index as first byte of sensor handle and return this modified version.
  *
@@ -115,42 +138,52 @@ HalProxy::~HalProxy() {
 }
 
 Return<void> HalProxy::getSensorsList_2_1(ISensorsV2_1::getSensorsList_2_1_cb _hidl_cb) {
-    std::vector<V2_1::SensorInfo> sensors;
-    for (const auto& iter : mSensors) {
-        sensors.push_back(iter.second);
-    }
-    _hidl_cb(sensors);
+    _hidl_cb(SensorListCache::getSensorsList_2_1());
     return Void();
 }
 
 Return<void> HalProxy::getSensorsList(ISensorsV2_0::getSensorsList_cb _hidl_cb) {
-    std::vector<V1_0::SensorInfo> sensors;
-    for (const auto& iter : mSensors) {
-      if (iter.second.type != SensorType::HINGE_ANGLE) {
-        sensors.push_back(convertToOldSensorInfo(iter.second));
-      }
-    }
-    _hidl_cb(sensors);
+    _hidl_cb(SensorListCache::getSensorsList());
     return Void();
 }
 
 Return<Result> HalProxy::setOperationMode(OperationMode mode) {
+    std::vector<std::future<Result>> results;
+    for (size_t subHalIndex = 0; subHalIndex < mSubHalList.size(); subHalIndex++) {
+        std::shared_ptr<ISubHalWrapperBase> subHal = mSubHalList[subHalIndex];
+        results.push_back(sConfigExecutor.post(subHalIndex, "setOperationMode",
+                                               [subHal, mode]() -> Result {
+                                                   return subHal->setOperationMode(mode);
+                                               }));
+    }
+
     Result result = Result::OK;
-    size_t subHalIndex;
-    for (subHalIndex = 0; subHalIndex < mSubHalList.size(); subHalIndex++) {
-        result = mSubHalList[subHalIndex]->setOperationMode(mode);
-        if (result != Result::OK) {
+    std::vector<size_t> flippedSubHals;
+    for (size_t subHalIndex = 0; subHalIndex < results.size(); subHalIndex++) {
+        Result currRes = results[subHalIndex].get();
+        if (currRes != Result::OK) {
             ALOGE("setOperationMode failed for SubHal: %s",
                   mSubHalList[subHalIndex]->getName().c_str());
-            break;
+            if (result == Result::OK) {
+                result = currRes;
+            }
+        } else {
+            flippedSubHals.push_back(subHalIndex);
         }
     }
 
     if (result != Result::OK) {
         // Reset the subhal operation modes that have been flipped
-        for (size_t i = 0; i < subHalIndex; i++) {
-            mSubHalList[i]->setOperationMode(mCurrentOperationMode);
+        std::vector<std::future<Result>> resets;
+        OperationMode currentMode = mCurrentOperationMode;
+        for (size_t subHalIndex : flippedSubHals) {
+            std::shared_ptr<ISubHalWrapperBase> subHal = mSubHalList[subHalIndex];
+            resets.push_back(sConfigExecutor.post(subHalIndex, "setOperationMode",
+                                                  [subHal, currentMode]() -> Result {
+                                                      return subHal->setOperationMode(currentMode);
+                                                  }));
         }
+        SubHalExecutor::waitAll(resets);
     } else {
         mCurrentOperationMode = mode;
     }
@@ -161,8 +194,30 @@ Return<Result> HalProxy::activate(int32_t sensorHandle, bool enabled) {
     if (!isSubHalIndexValid(sensorHandle)) {
         return Result::BAD_VALUE;
     }
-    return getSubHalForSensorHandle(sensorHandle)
-            ->activate(clearSubHalIndex(sensorHandle), enabled);
+    if (enabled) {
+        // Deliver the first event after activation even if it repeats the last value.
+        OnChangeFilter::reset(sensorHandle);
+        RateGovernor::reset(sensorHandle);
+    }
+    std::shared_ptr<ISubHalWrapperBase> subHal = getSubHalForSensorHandle(sensorHandle);
+    int32_t subHalSensorHandle = clearSubHalIndex(sensorHandle);
+    std::optional<Event> replay;
+    Result result = DeactivateDebouncer::activate(
+            sensorHandle, enabled,
+            [subHal, subHalSensorHandle](bool enable) -> Result {
+                return subHal->activate(subHalSensorHandle, enable);
+            },
+            &replay);
+    if (replay) {
+        // The sensor was kept on and won't report its initial value again, post the last one as
+        // its sub-HAL would, wakelock included.
+        bool wakeUp = (getSensorInfo(sensorHandle).flags & V1_0::SensorFlagBits::WAKE_UP) != 0;
+        replay->sensorHandle = subHalSensorHandle;
+        int32_t subHalIndex = static_cast<int32_t>(extractSubHalIndex(sensorHandle));
+        sp<HalProxyCallbackV2_1> callback = new HalProxyCallbackV2_1(this, this, subHalIndex);
+        callback->postEvents({*replay}, callback->createScopedWakelock(wakeUp));
+    }
+    return result;
 }
 
 Return<Result> HalProxy::initialize_2_1(
@@ -222,9 +277,13 @@ Return<Result> HalProxy::initializeCommon(
     // again we do not get new events until after initialize resets the subhals.
     disableAllSensors();
 
-    // Clears the queue if any events were pending write before.
-    mPendingWriteEventsQueue = std::queue<std::pair<std::vector<V2_1::Event>, size_t>>();
-    mSizePendingWriteEventsQueue = 0;
+    // Clears the queue if any events were pending write before. Sub-HAL callbacks may still be
+    // posting, so this goes under the lock like every other access.
+    {
+        ProfiledLock<std::mutex> lock(mEventQueueWriteMutex, LockSite::kInitializeCommon);
+        sPendingEvents.clear();
+        mSizePendingWriteEventsQueue = 0;
+    }
 
     // Clears previously connected dynamic sensors
     mDynamicSensors.clear();
@@ -259,8 +318,15 @@ Return<Result> HalProxy::initializeCommon(
     mPendingWritesThread = std::thread(startPendingWritesThread, this);
     mWakelockThread = std::thread(startWakelockThread, this);
 
+    std::vector<std::future<Result>> results;
     for (size_t i = 0; i < mSubHalList.size(); i++) {
-        Result currRes = mSubHalList[i]->initialize(this, this, i);
+        std::shared_ptr<ISubHalWrapperBase> subHal = mSubHalList[i];
+        results.push_back(sConfigExecutor.post(i, "initialize", [this, subHal, i]() -> Result {
+            return subHal->initialize(this, this, i);
+        }));
+    }
+    for (size_t i = 0; i < results.size(); i++) {
+        Result currRes = results[i].get();
         if (currRes != Result::OK) {
             result = currRes;
             ALOGE("Subhal '%s' failed to initialize with reason %" PRId32 ".",
@@ -278,6 +344,7 @@ Return<Result> HalProxy::batch(int32_t sensorHandle, int64_t samplingPeriodNs,
     if (!isSubHalIndexValid(sensorHandle)) {
         return Result::BAD_VALUE;
     }
+    RateGovernor::setPeriod(sensorHandle, samplingPeriodNs);
     return getSubHalForSensorHandle(sensorHandle)
             ->batch(clearSubHalIndex(sensorHandle), samplingPeriodNs, maxReportLatencyNs);
 }
@@ -373,15 +440,24 @@ Return<void> HalProxy::debug(const hidl_handle& fd, const hidl_vec<hidl_string>&
            << std::endl;
     stream << " Most events seen on pending write events queue: "
            << mMostEventsObservedPendingWriteEventsQueue << std::endl;
-    if (!mPendingWriteEventsQueue.empty()) {
-        stream << "  Size of events list on front of pending writes queue: "
-               << mPendingWriteEventsQueue.front().first.size() << std::endl;
+    {
+        ProfiledLock<std::mutex> lock(mEventQueueWriteMutex, LockSite::kDebug);
+        sPendingEvents.dump(stream);
     }
     stream << "  # of non-dynamic sensors across all subhals: " << mSensors.size() << std::endl;
     stream << "  # of dynamic sensors across all subhals: " << mDynamicSensors.size() << std::endl;
+    ThreadPolicy::dump(stream);
+    AlsCorrection::dump(stream);
+    CameraProtect::dump(stream);
+    OnChangeFilter::dump(stream);
+    RateGovernor::dump(stream);
+    DeactivateDebouncer::dump(stream);
+    LockProfiler::dump(stream);
     stream << "SubHals (" << mSubHalList.size() << "):" << std::endl;
-    for (auto& subHal : mSubHalList) {
+    for (size_t subHalIndex = 0; subHalIndex < mSubHalList.size(); subHalIndex++) {
+        auto& subHal = mSubHalList[subHalIndex];
         stream << "  Name: " << subHal->getName() << std::endl;
+        sConfigExecutor.dump(stream, subHalIndex);
         stream << "  Debug dump: " << std::endl;
         android::base::WriteStringToFd(stream.str(), writeFd);
         subHal->debug(fd, {});
@@ -396,7 +472,7 @@ Return<void> HalProxy::onDynamicSensorsConnected(const hidl_vec<SensorInfo>& dyn
                                                  int32_t subHalIndex) {
     std::vector<SensorInfo> sensors;
     {
-        std::lock_guard<std::mutex> lock(mDynamicSensorsMutex);
+        ProfiledLock<std::mutex> lock(mDynamicSensorsMutex, LockSite::kDynamicSensorsConnected);
         for (SensorInfo sensor : dynamicSensorsAdded) {
             if (!subHalIndexIsClear(sensor.sensorHandle)) {
                 ALOGE("Dynamic sensor added %s had sensorHandle with first byte not 0.",
@@ -417,7 +493,8 @@ Return<void> HalProxy::onDynamicSensorsDisconnected(
     // TODO(b/143302327): Block this call until all pending events are flushed from queue
     std::vector<int32_t> sensorHandles;
     {
-        std::lock_guard<std::mutex> lock(mDynamicSensorsMutex);
+        ProfiledLock<std::mutex> lock(mDynamicSensorsMutex,
+                                      LockSite::kDynamicSensorsDisconnected);
         for (int32_t sensorHandle : dynamicSensorHandlesRemoved) {
             if (!subHalIndexIsClear(sensorHandle)) {
                 ALOGE("Dynamic sensorHandle removed had first byte not 0.");
@@ -435,6 +512,7 @@ Return<void> HalProxy::onDynamicSensorsDisconnected(
 }
 
 void HalProxy::initializeSubHalListFromConfigFile(const char* configFileName) {
+    std::vector<std::string> loadedLibraries;
     std::ifstream subHalConfigStream(configFileName);
     if (!subHalConfigStream) {
         ALOGE("Failed to load subHal config file: %s", configFileName);
@@ -458,6 +536,7 @@ void HalProxy::initializeSubHalListFromConfigFile(const char* configFileName) {
                     } else {
                         ALOGV("Loaded SubHal from library: %s", subHalLibraryFile.c_str());
                         mSubHalList.push_back(std::make_unique<SubHalWrapperV2_0>(subHal));
+                        loadedLibraries.push_back(subHalLibraryFile);
                     }
                 } else {
                     SensorsHalGetSubHalV2_1Func* getSubHalV2_1Ptr =
@@ -477,38 +556,63 @@ void HalProxy::initializeSubHalListFromConfigFile(const char* configFileName) {
                         } else {
                             ALOGV("Loaded SubHal from library: %s", subHalLibraryFile.c_str());
                             mSubHalList.push_back(std::make_unique<SubHalWrapperV2_1>(subHal));
+                            loadedLibraries.push_back(subHalLibraryFile);
                         }
                     }
                 }
             }
         }
     }
+    SensorListCache::setKey(configFileName, loadedLibraries);
 }
 
 void HalProxy::initializeSensorList() {
+    // The raw lists only depend on the sub-HAL builds, reuse them across HAL restarts.
+    std::vector<std::vector<SensorInfo>> subHalSensors;
+    if (SensorListCache::load(mSubHalList.size(), &subHalSensors)) {
+        ALOGI("Loaded sensor list from cache");
+    } else {
+        bool complete = true;
+        subHalSensors.resize(mSubHalList.size());
+        for (size_t subHalIndex = 0; subHalIndex < mSubHalList.size(); subHalIndex++) {
+            auto result = mSubHalList[subHalIndex]->getSensorsList([&](const auto& list) {
+                subHalSensors[subHalIndex] = list;
+            });
+            if (!result.isOk()) {
+                ALOGE("getSensorsList call failed for SubHal: %s",
+                      mSubHalList[subHalIndex]->getName().c_str());
+                complete = false;
+            }
+        }
+        if (complete) {
+            SensorListCache::store(subHalSensors);
+        }
+    }
+
     for (size_t subHalIndex = 0; subHalIndex < mSubHalList.size(); subHalIndex++) {
-        auto result = mSubHalList[subHalIndex]->getSensorsList([&](const auto& list) {
-            for (SensorInfo sensor : list) {
-                if (!subHalIndexIsClear(sensor.sensorHandle)) {
-                    ALOGE("SubHal sensorHandle's first byte was not 0");
-                } else {
-                    ALOGV("Loaded sensor: %s", sensor.name.c_str());
-                    sensor.sensorHandle = setSubHalIndex(sensor.sensorHandle, subHalIndex);
-                    setDirectChannelFlags(&sensor, mSubHalList[subHalIndex]);
-                    if (static_cast<int>(sensor.type) == SENSOR_TYPE_QTI_WISE_LIGHT) {
-                        sensor.type = SensorType::LIGHT;
-                        ALOGV("Replaced QTI Light sensor with standard light sensor");
-                        AlsCorrection::init();
-                    }
-                    mSensors[sensor.sensorHandle] = sensor;
+        for (SensorInfo sensor : subHalSensors[subHalIndex]) {
+            if (!subHalIndexIsClear(sensor.sensorHandle)) {
+                ALOGE("SubHal sensorHandle's first byte was not 0");
+            } else {
+                ALOGV("Loaded sensor: %s", sensor.name.c_str());
+                sensor.sensorHandle = setSubHalIndex(sensor.sensorHandle, subHalIndex);
+                setDirectChannelFlags(&sensor, mSubHalList[subHalIndex]);
+                if (static_cast<int>(sensor.type) == SENSOR_TYPE_QTI_WISE_LIGHT) {
+                    sensor.type = SensorType::LIGHT;
+                    ALOGV("Replaced QTI Light sensor with standard light sensor");
+                    AlsCorrection::init();
                 }
+                if (sensor.typeAsString == kCameraProtectSensorType) {
+                    CameraProtect::init(sensor.sensorHandle);
+                }
+                mSensors[sensor.sensorHandle] = sensor;
             }
-        });
-        if (!result.isOk()) {
-            ALOGE("getSensorsList call failed for SubHal: %s",
-                  mSubHalList[subHalIndex]->getName().c_str());
         }
     }
+    SensorListCache::publish(mSensors);
+    OnChangeFilter::init(mSensors);
+    RateGovernor::init(mSensors);
+    DeactivateDebouncer::init(mSensors);
 }
 
 void* HalProxy::getHandleForSubHalSharedObject(const std::string& filename) {
@@ -531,7 +635,9 @@ void* HalProxy::getHandleForSubHalSharedObject(const std::string& filename) {
 }
 
 void HalProxy::init() {
+    LockProfiler::init();
     initializeSensorList();
+    sConfigExecutor.start(mSubHalList.size());
 }
 
 void HalProxy::stopThreads() {
@@ -558,44 +664,72 @@ void HalProxy::stopThreads() {
 }
 
 void HalProxy::disableAllSensors() {
+    // Every sensor is turned off below, and a re-activation must not be dropped against a
+    // deactivation still pending from before.
+    DeactivateDebouncer::cancelAll();
+    std::vector<std::future<Result>> results;
+    auto disableSensor = [&](int32_t sensorHandle) {
+        if (!isSubHalIndexValid(sensorHandle)) {
+            return;
+        }
+        std::shared_ptr<ISubHalWrapperBase> subHal = getSubHalForSensorHandle(sensorHandle);
+        int32_t subHalSensorHandle = clearSubHalIndex(sensorHandle);
+        results.push_back(sConfigExecutor.post(extractSubHalIndex(sensorHandle), "activate",
+                                               [subHal, subHalSensorHandle]() -> Result {
+                                                   return subHal->activate(subHalSensorHandle,
+                                                                           false /* enabled */);
+                                               }));
+    };
     for (const auto& sensorEntry : mSensors) {
-        int32_t sensorHandle = sensorEntry.first;
-        activate(sensorHandle, false /* enabled */);
+        disableSensor(sensorEntry.first);
     }
-    std::lock_guard<std::mutex> dynamicSensorsLock(mDynamicSensorsMutex);
-    for (const auto& sensorEntry : mDynamicSensors) {
-        int32_t sensorHandle = sensorEntry.first;
-        activate(sensorHandle, false /* enabled */);
+    {
+        ProfiledLock<std::mutex> dynamicSensorsLock(mDynamicSensorsMutex,
+                                                    LockSite::kDisableAllSensors);
+        for (const auto& sensorEntry : mDynamicSensors) {
+            disableSensor(sensorEntry.first);
+        }
     }
+    SubHalExecutor::waitAll(results);
 }
 
 void HalProxy::startPendingWritesThread(HalProxy* halProxy) {
+    ThreadPolicy::apply("pending_writes", "HalProxyWrites");
+    LockProfiler::setThreadRole(LockProfiler::Role::kPendingWriter);
     halProxy->handlePendingWrites();
 }
 
 void HalProxy::handlePendingWrites() {
     // TODO(b/143302327): Find a way to optimize locking strategy maybe using two mutexes instead of
     // one.
-    std::unique_lock<std::mutex> lock(mEventQueueWriteMutex);
+    ProfiledLock<std::mutex> lock(mEventQueueWriteMutex, LockSite::kPendingWrites);
     while (mThreadsRun.load()) {
-        mEventQueueWriteCV.wait(
-                lock, [&] { return !mPendingWriteEventsQueue.empty() || !mThreadsRun.load(); });
+        lock.wait(mEventQueueWriteCV,
+                  [&] { return !sPendingEvents.empty() || !mThreadsRun.load(); });
         if (mThreadsRun.load()) {
-            std::vector<Event>& pendingWriteEvents = mPendingWriteEventsQueue.front().first;
-            size_t numWakeupEvents = mPendingWriteEventsQueue.front().second;
+            size_t numPendingEvents = sPendingEvents.frontSize();
+            size_t numWakeupEvents = sPendingEvents.frontWakeupEvents();
             size_t eventQueueSize = mEventQueue->getQuantumCount();
-            size_t numToWrite = std::min(pendingWriteEvents.size(), eventQueueSize);
+            // Other threads only append, and initializeCommon() clears the queue once this thread
+            // has been joined, so the front batch stays put while unlocked.
+            sPendingEvents.peekFront(eventQueueSize, &sPendingWriteBuffer);
+            size_t numToWrite = sPendingWriteBuffer.size();
             lock.unlock();
-            if (!mEventQueue->writeBlocking(
-                        pendingWriteEvents.data(), numToWrite,
+            bool written;
+            {
+                SENSORS_TRACE_SCOPE("HalProxy::writeBlocking");
+                written = mEventQueue->writeBlocking(
+                        sPendingWriteBuffer.data(), numToWrite,
                         static_cast<uint32_t>(EventQueueFlagBits::EVENTS_READ),
                         static_cast<uint32_t>(EventQueueFlagBits::READ_AND_PROCESS),
-                        kPendingWriteTimeoutNs, mEventQueueFlag)) {
+                        kPendingWriteTimeoutNs, mEventQueueFlag);
+            }
+            if (!written) {
                 ALOGE("Dropping %zu events after blockingWrite failed.", numToWrite);
                 if (numWakeupEvents > 0) {
-                    if (pendingWriteEvents.size() > eventQueueSize) {
+                    if (numPendingEvents > eventQueueSize) {
                         decrementRefCountAndMaybeReleaseWakelock(
-                                countNumWakeupEvents(pendingWriteEvents, eventQueueSize));
+                                countNumWakeupEvents(sPendingWriteBuffer, eventQueueSize));
                     } else {
                         decrementRefCountAndMaybeReleaseWakelock(numWakeupEvents);
                     }
@@ -603,26 +737,22 @@ void HalProxy::handlePendingWrites() {
             }
             lock.lock();
             mSizePendingWriteEventsQueue -= numToWrite;
-            if (pendingWriteEvents.size() > eventQueueSize) {
-                // TODO(b/143302327): Check if this erase operation is too inefficient. It will copy
-                // all the events ahead of it down to fill gap off array at front after the erase.
-                pendingWriteEvents.erase(pendingWriteEvents.begin(),
-                                         pendingWriteEvents.begin() + eventQueueSize);
-            } else {
-                mPendingWriteEventsQueue.pop();
-            }
+            SENSORS_TRACE_COUNTER("sensors.pending_events", mSizePendingWriteEventsQueue);
+            sPendingEvents.popFront(numToWrite);
         }
     }
 }
 
 void HalProxy::startWakelockThread(HalProxy* halProxy) {
+    ThreadPolicy::apply("wakelock", "HalProxyWakelk");
+    LockProfiler::setThreadRole(LockProfiler::Role::kWakelockThread);
     halProxy->handleWakelocks();
 }
 
 void HalProxy::handleWakelocks() {
-    std::unique_lock<std::recursive_mutex> lock(mWakelockMutex);
+    ProfiledLock<std::recursive_mutex> lock(mWakelockMutex, LockSite::kHandleWakelocks);
     while (mThreadsRun.load()) {
-        mWakelockCV.wait(lock, [&] { return mWakelockRefCount > 0 || !mThreadsRun.load(); });
+        lock.wait(mWakelockCV, [&] { return mWakelockRefCount > 0 || !mThreadsRun.load(); });
         if (mThreadsRun.load()) {
             int64_t timeLeft;
             if (sharedWakelockDidTimeout(&timeLeft)) {
@@ -657,30 +787,28 @@ bool HalProxy::sharedWakelockDidTimeout(int64_t* timeLeft) {
 }
 
 void HalProxy::resetSharedWakelock() {
-    std::lock_guard<std::recursive_mutex> lockGuard(mWakelockMutex);
+    ProfiledLock<std::recursive_mutex> lockGuard(mWakelockMutex, LockSite::kResetWakelock);
     decrementRefCountAndMaybeReleaseWakelock(mWakelockRefCount);
     mWakelockTimeoutResetTime = getTimeNow();
 }
 
-void HalProxy::postEventsToMessageQueue(const std::vector<Event>& eventsList, size_t numWakeupEvents,
+void HalProxy::postEventsToMessageQueue(const std::vector<Event>& events, size_t numWakeupEvents,
                                         V2_0::implementation::ScopedWakelock wakelock) {
+    SENSORS_TRACE_SCOPE("HalProxy::postEventsToMessageQueue");
     size_t numToWrite = 0;
-    std::lock_guard<std::mutex> lock(mEventQueueWriteMutex);
+    ProfiledLock<std::mutex> lock(mEventQueueWriteMutex, LockSite::kPostEvents);
     if (wakelock.isLocked()) {
         incrementRefCountAndMaybeAcquireWakelock(numWakeupEvents);
     }
-    std::vector<Event> events(eventsList);
-    for (auto& event : events) {
-        if (static_cast<int>(event.sensorType) == SENSOR_TYPE_QTI_WISE_LIGHT) {
-            AlsCorrection::correct(event.u.scalar);
-        }
-    }
-    if (mPendingWriteEventsQueue.empty()) {
+    // The events were already processed in HalProxyCallbackBase::processEvents, write them as is.
+    if (sPendingEvents.empty()) {
         numToWrite = std::min(events.size(), mEventQueue->availableToWrite());
         if (numToWrite > 0) {
+            SENSORS_TRACE_SCOPE("HalProxy::writeEventQueue");
             if (mEventQueue->write(events.data(), numToWrite)) {
                 // TODO(b/143302327): While loop if mEventQueue->avaiableToWrite > 0 to possibly fit
                 // in more writes immediately
+                SENSORS_TRACE_SCOPE("HalProxy::wakeEventQueue");
                 mEventQueueFlag->wake(static_cast<uint32_t>(EventQueueFlagBits::READ_AND_PROCESS));
             } else {
                 numToWrite = 0;
@@ -690,11 +818,11 @@ void HalProxy::postEventsToMessageQueue(const std::vector<Event>& eventsList, si
     size_t numLeft = events.size() - numToWrite;
     if (numToWrite < events.size() &&
         mSizePendingWriteEventsQueue + numLeft <= kMaxSizePendingWriteEventsQueue) {
-        std::vector<Event> eventsLeft(events.begin() + numToWrite, events.end());
-        mPendingWriteEventsQueue.push({eventsLeft, numWakeupEvents});
+        sPendingEvents.push(events.data() + numToWrite, numLeft, numWakeupEvents);
         mSizePendingWriteEventsQueue += numLeft;
         mMostEventsObservedPendingWriteEventsQueue =
                 std::max(mMostEventsObservedPendingWriteEventsQueue, mSizePendingWriteEventsQueue);
+        SENSORS_TRACE_COUNTER("sensors.pending_events", mSizePendingWriteEventsQueue);
         mEventQueueWriteCV.notify_one();
     }
 }
@@ -702,13 +830,15 @@ void HalProxy::postEventsToMessageQueue(const std::vector<Event>& eventsList, si
 bool HalProxy::incrementRefCountAndMaybeAcquireWakelock(size_t delta,
                                                         int64_t* timeoutStart /* = nullptr */) {
     if (!mThreadsRun.load()) return false;
-    std::lock_guard<std::recursive_mutex> lockGuard(mWakelockMutex);
+    ProfiledLock<std::recursive_mutex> lockGuard(mWakelockMutex, LockSite::kAcquireWakelock);
     if (mWakelockRefCount == 0) {
+        SENSORS_TRACE_SCOPE("HalProxy::acquireWakelock");
         acquire_wake_lock(PARTIAL_WAKE_LOCK, kWakelockName);
         mWakelockCV.notify_one();
     }
     mWakelockTimeoutStartTime = getTimeNow();
     mWakelockRefCount += delta;
+    SENSORS_TRACE_COUNTER("sensors.wakelock_refcount", mWakelockRefCount);
     if (timeoutStart != nullptr) {
         *timeoutStart = mWakelockTimeoutStartTime;
     }
@@ -718,7 +848,7 @@ bool HalProxy::incrementRefCountAndMaybeAcquireWakelock(size_t delta,
 void HalProxy::decrementRefCountAndMaybeReleaseWakelock(size_t delta,
                                                         int64_t timeoutStart /* = -1 */) {
     if (!mThreadsRun.load()) return;
-    std::lock_guard<std::recursive_mutex> lockGuard(mWakelockMutex);
+    ProfiledLock<std::recursive_mutex> lockGuard(mWakelockMutex, LockSite::kReleaseWakelock);
     if (delta > mWakelockRefCount) {
         ALOGE("Decrementing wakelock ref count by %zu when count is %zu",
               delta, mWakelockRefCount);
@@ -726,7 +856,9 @@ void HalProxy::decrementRefCountAndMaybeReleaseWakelock(size_t delta,
     if (timeoutStart == -1) timeoutStart = mWakelockTimeoutResetTime;
     if (mWakelockRefCount == 0 || timeoutStart < mWakelockTimeoutResetTime) return;
     mWakelockRefCount -= std::min(mWakelockRefCount, delta);
+    SENSORS_TRACE_COUNTER("sensors.wakelock_refcount", mWakelockRefCount);
     if (mWakelockRefCount == 0) {
+        SENSORS_TRACE_SCOPE("HalProxy::releaseWakelock");
         release_wake_lock(kWakelockName);
     }
 }
@@ -758,7 +890,12 @@ size_t HalProxy::countNumWakeupEvents(const std::vector<Event>& events, size_t n
     size_t numWakeupEvents = 0;
     for (size_t i = 0; i < n; i++) {
         int32_t sensorHandle = events[i].sensorHandle;
-        if (mSensors[sensorHandle].flags & static_cast<uint32_t>(V1_0::SensorFlagBits::WAKE_UP)) {
+        bool wakeUp;
+        if (!SensorListCache::lookupWakeUp(sensorHandle, &wakeUp)) {
+            wakeUp = mSensors[sensorHandle].flags &
+                     static_cast<uint32_t>(V1_0::SensorFlagBits::WAKE_UP);
+        }
+        if (wakeUp) {
             numWakeupEvents++;
         }
     }
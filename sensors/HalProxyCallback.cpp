@@ -16,6 +16,14 @@
 
 #include "HalProxyCallback.h"
 
+#include "AlsCorrection.h"
+#include "CameraProtect.h"
+#include "DeactivateDebouncer.h"
+#include "OnChangeFilter.h"
+#include "RateGovernor.h"
+#include "SensorListCache.h"
+#include "SensorsTrace.h"
+
 #include <cinttypes>
 
 namespace android {
@@ -40,9 +48,11 @@ int32_t setSubHalIndex(int32_t sensorHandle, size_t subHalIndex) {
 
 void HalProxyCallbackBase::postEvents(const std::vector<V2_1::Event>& events,
                                       ScopedWakelock wakelock) {
+    SENSORS_TRACE_SCOPE("HalProxyCallback::postEvents");
     if (events.empty() || !mCallback->areThreadsRunning()) return;
     size_t numWakeupEvents;
     std::vector<V2_1::Event> processedEvents = processEvents(events, &numWakeupEvents);
+    if (processedEvents.empty()) return;
     if (numWakeupEvents > 0) {
         ALOG_ASSERT(wakelock.isLocked(),
                     "Wakeup events posted while wakelock unlocked for subhal"
@@ -62,22 +72,51 @@ ScopedWakelock HalProxyCallbackBase::createScopedWakelock(bool lock) {
     return wakelock;
 }
 
+/*
+ * The single pass over the events of a sub-HAL: the sub-HAL index is added to the handles, the
+ * events of sensors being deactivated are dropped, the wake-up events are counted, samples beyond
+ * the requested rate are dropped, the ALS correction and camera reflex are applied and repeated
+ * on-change values are dropped, so that HalProxy can write the result to the FMQ as is. The
+ * events are copied once, in bulk, V1_0 events of 2.0 sub-HALs having already been reinterpreted
+ * as V2_1 events.
+ */
 std::vector<V2_1::Event> HalProxyCallbackBase::processEvents(const std::vector<V2_1::Event>& events,
                                                              size_t* numWakeupEvents) const {
+    SENSORS_TRACE_SCOPE("HalProxyCallback::processEvents");
     *numWakeupEvents = 0;
-    std::vector<V2_1::Event> eventsOut;
-    for (V2_1::Event event : events) {
+    std::vector<V2_1::Event> eventsOut(events);
+    size_t numEventsOut = 0;
+    for (V2_1::Event& event : eventsOut) {
         event.sensorHandle = setSubHalIndex(event.sensorHandle, mSubHalIndex);
         if (event.sensorType == V2_1::SensorType::DYNAMIC_SENSOR_META) {
             event.u.dynamic.sensorHandle =
                     setSubHalIndex(event.u.dynamic.sensorHandle, mSubHalIndex);
         }
-        eventsOut.push_back(event);
-        const V2_1::SensorInfo& sensor = mCallback->getSensorInfo(event.sensorHandle);
-        if ((sensor.flags & V1_0::SensorFlagBits::WAKE_UP) != 0) {
+        bool wakeUp;
+        if (!V2_1::implementation::SensorListCache::lookupWakeUp(event.sensorHandle, &wakeUp)) {
+            const V2_1::SensorInfo& sensor = mCallback->getSensorInfo(event.sensorHandle);
+            wakeUp = (sensor.flags & V1_0::SensorFlagBits::WAKE_UP) != 0;
+        }
+        if (V2_1::implementation::DeactivateDebouncer::discard(event, wakeUp)) {
+            continue;
+        }
+        if (wakeUp) {
             (*numWakeupEvents)++;
+        } else if (V2_1::implementation::RateGovernor::decimate(event)) {
+            continue;
+        }
+        if (static_cast<int>(event.sensorType) ==
+            V2_1::implementation::SENSOR_TYPE_QTI_WISE_LIGHT) {
+            SENSORS_TRACE_SCOPE("AlsCorrection::correct");
+            V2_1::implementation::AlsCorrection::correct(event.u.scalar);
+        }
+        V2_1::implementation::CameraProtect::process(event);
+        if (!wakeUp && V2_1::implementation::OnChangeFilter::suppress(event)) {
+            continue;
         }
+        eventsOut[numEventsOut++] = event;
     }
+    eventsOut.resize(numEventsOut);
     return eventsOut;
 }
 
@@ -0,0 +1,145 @@
+/*
+ * Copyright (C) 2024 The LineageOS Project
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "LockProfiler.h"
+
+#include <android-base/properties.h>
+#include <android-base/strings.h>
+#include <log/log.h>
+
+#include <pthread.h>
+
+#include <atomic>
+#include <iomanip>
+
+using android::base::GetBoolProperty;
+
+namespace android {
+namespace hardware {
+namespace sensors {
+namespace V2_1 {
+namespace implementation {
+
+namespace {
+
+struct SiteInfo {
+    const char* name;
+    const char* lock;
+};
+
+const SiteInfo kSites[static_cast<size_t>(LockSite::kCount)] = {
+        {"debug", "mEventQueueWriteMutex"},
+        {"onDynamicSensorsConnected", "mDynamicSensorsMutex"},
+        {"onDynamicSensorsDisconnected", "mDynamicSensorsMutex"},
+        {"disableAllSensors", "mDynamicSensorsMutex"},
+        {"initializeCommon", "mEventQueueWriteMutex"},
+        {"handlePendingWrites", "mEventQueueWriteMutex"},
+        {"postEventsToMessageQueue", "mEventQueueWriteMutex"},
+        {"handleWakelocks", "mWakelockMutex"},
+        {"resetSharedWakelock", "mWakelockMutex"},
+        {"incrementRefCountAndMaybeAcquireWakelock", "mWakelockMutex"},
+        {"decrementRefCountAndMaybeReleaseWakelock", "mWakelockMutex"},
+};
+
+const char* const kRoles[static_cast<size_t>(LockProfiler::Role::kCount)] = {
+        "sub-HAL callback",
+        "pending writer",
+        "wakelock thread",
+        "HIDL",
+};
+
+struct Stats {
+    std::atomic<uint64_t> acquisitions;
+    std::atomic<uint64_t> contended;
+    std::atomic<int64_t> waitNs;
+    std::atomic<int64_t> maxWaitNs;
+    std::atomic<int64_t> holdNs;
+    std::atomic<int64_t> maxHoldNs;
+};
+
+void updateMax(std::atomic<int64_t>& max, int64_t value) {
+    int64_t current = max.load(std::memory_order_relaxed);
+    while (value > current &&
+           !max.compare_exchange_weak(current, value, std::memory_order_relaxed)) {
+    }
+}
+
+}  // namespace
+
+bool LockProfiler::sEnabled;
+
+static Stats stats[static_cast<size_t>(LockSite::kCount)]
+                  [static_cast<size_t>(LockProfiler::Role::kCount)];
+
+// Unset until the first lock taken by the thread.
+static thread_local int thread_role = -1;
+
+void LockProfiler::init() {
+    sEnabled = GetBoolProperty("vendor.sensors.proxy.lock_profiling", false);
+    if (sEnabled) {
+        ALOGI("Lock profiling enabled");
+    }
+}
+
+void LockProfiler::setThreadRole(Role role) {
+    thread_role = static_cast<int>(role);
+}
+
+void LockProfiler::record(LockSite site, bool contended, int64_t waitNs, int64_t holdNs) {
+    if (thread_role < 0) {
+        char name[16] = {};
+        pthread_getname_np(pthread_self(), name, sizeof(name));
+        thread_role = static_cast<int>(android::base::StartsWith(name, "HwBinder")
+                                               ? Role::kHidl
+                                               : Role::kSubHalCallback);
+    }
+
+    Stats& s = stats[static_cast<size_t>(site)][thread_role];
+    s.acquisitions.fetch_add(1, std::memory_order_relaxed);
+    if (contended) {
+        s.contended.fetch_add(1, std::memory_order_relaxed);
+    }
+    s.waitNs.fetch_add(waitNs, std::memory_order_relaxed);
+    s.holdNs.fetch_add(holdNs, std::memory_order_relaxed);
+    updateMax(s.maxWaitNs, waitNs);
+    updateMax(s.maxHoldNs, holdNs);
+}
+
+void LockProfiler::dump(std::ostream& stream) {
+    if (!sEnabled) {
+        return;
+    }
+
+    stream << "Lock profile (wait and hold times in us):" << std::endl;
+    auto flags = stream.flags();
+    stream << std::fixed << std::setprecision(1);
+    for (size_t site = 0; site < static_cast<size_t>(LockSite::kCount); site++) {
+        for (size_t role = 0; role < static_cast<size_t>(Role::kCount); role++) {
+            const Stats& s = stats[site][role];
+            uint64_t acquisitions = s.acquisitions.load(std::memory_order_relaxed);
+            if (acquisitions == 0) {
+                continue;
+            }
+            uint64_t contended = s.contended.load(std::memory_order_relaxed);
+            stream << "  " << kSites[site].lock << " in " << kSites[site].name << ", "
+                   << kRoles[role] << ": " << acquisitions << " acquisitions, " << contended
+                   << " contended (" << 100.0 * contended / acquisitions << "%), wait avg "
+                   << s.waitNs.load(std::memory_order_relaxed) / 1000.0 / acquisitions
+                   << " max " << s.maxWaitNs.load(std::memory_order_relaxed) / 1000.0
+                   << ", hold avg "
+                   << s.holdNs.load(std::memory_order_relaxed) / 1000.0 / acquisitions
+                   << " max " << s.maxHoldNs.load(std::memory_order_relaxed) / 1000.0
+                   << std::endl;
+        }
+    }
+    stream.flags(flags);
+}
+
+}  // namespace implementation
+}  // namespace V2_1
+}  // namespace sensors
+}  // namespace hardware
+}  // namespace android
@@ -0,0 +1,145 @@
+/*
+ * Copyright (C) 2024 The LineageOS Project
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <ostream>
+
+namespace android {
+namespace hardware {
+namespace sensors {
+namespace V2_1 {
+namespace implementation {
+
+//! The places HalProxy takes its locks.
+enum class LockSite {
+    kDebug,
+    kDynamicSensorsConnected,
+    kDynamicSensorsDisconnected,
+    kDisableAllSensors,
+    kInitializeCommon,
+    kPendingWrites,
+    kPostEvents,
+    kHandleWakelocks,
+    kResetWakelock,
+    kAcquireWakelock,
+    kReleaseWakelock,
+    kCount,
+};
+
+/**
+ * Opt-in profiling of the HalProxy locks, enabled through vendor.sensors.proxy.lock_profiling.
+ * Every acquisition made through ProfiledLock is recorded against its code site and the kind of
+ * thread taking it, with whether it had to wait, how long it waited and how long the lock was
+ * held. When disabled, ProfiledLock costs one branch over std::unique_lock.
+ */
+class LockProfiler {
+  public:
+    enum class Role {
+        kSubHalCallback,
+        kPendingWriter,
+        kWakelockThread,
+        kHidl,
+        kCount,
+    };
+
+    //! Read the property, called once before the proxy threads start.
+    static void init();
+
+    static bool enabled() { return sEnabled; }
+
+    /**
+     * Mark the calling thread as one of the proxy threads. Other threads are told apart by
+     * name, HwBinder threads serving HIDL calls and anything else being a sub-HAL thread.
+     */
+    static void setThreadRole(Role role);
+
+    static void record(LockSite site, bool contended, int64_t waitNs, int64_t holdNs);
+
+    static void dump(std::ostream& stream);
+
+    static int64_t nowNs() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                       std::chrono::steady_clock::now().time_since_epoch())
+                .count();
+    }
+
+  private:
+    static bool sEnabled;
+};
+
+/**
+ * std::unique_lock recording to LockProfiler. Condition variable waits have to go through
+ * wait(), so that the time spent waiting is not counted as held.
+ */
+template <typename Mutex>
+class ProfiledLock {
+  public:
+    ProfiledLock(Mutex& mutex, LockSite site) : mLock(mutex, std::defer_lock), mSite(site) {
+        lock();
+    }
+
+    ~ProfiledLock() {
+        if (mLock.owns_lock()) {
+            unlock();
+        }
+    }
+
+    ProfiledLock(const ProfiledLock&) = delete;
+    ProfiledLock& operator=(const ProfiledLock&) = delete;
+
+    void lock() {
+        if (!LockProfiler::enabled()) {
+            mLock.lock();
+            return;
+        }
+        int64_t start = LockProfiler::nowNs();
+        mContended = !mLock.try_lock();
+        if (mContended) {
+            mLock.lock();
+        }
+        mAcquiredNs = LockProfiler::nowNs();
+        mWaitNs = mAcquiredNs - start;
+    }
+
+    void unlock() {
+        recordHold();
+        mLock.unlock();
+    }
+
+    template <typename ConditionVariable, typename Predicate>
+    void wait(ConditionVariable& cv, Predicate predicate) {
+        recordHold();
+        cv.wait(mLock, predicate);
+        if (LockProfiler::enabled()) {
+            mContended = false;
+            mWaitNs = 0;
+            mAcquiredNs = LockProfiler::nowNs();
+        }
+    }
+
+  private:
+    void recordHold() {
+        if (LockProfiler::enabled()) {
+            LockProfiler::record(mSite, mContended, mWaitNs, LockProfiler::nowNs() - mAcquiredNs);
+        }
+    }
+
+    std::unique_lock<Mutex> mLock;
+    LockSite mSite;
+    bool mContended = false;
+    int64_t mWaitNs = 0;
+    int64_t mAcquiredNs = 0;
+};
+
+}  // namespace implementation
+}  // namespace V2_1
+}  // namespace sensors
+}  // namespace hardware
+}  // namespace android
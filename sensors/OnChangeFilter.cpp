@@ -0,0 +1,123 @@
+/*
+ * Copyright (C) 2024 The LineageOS Project
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "OnChangeFilter.h"
+
+#include "CompactEventQueue.h"
+
+#include <android-base/properties.h>
+#include <log/log.h>
+
+#include <cinttypes>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+using android::base::GetIntProperty;
+
+namespace android {
+namespace hardware {
+namespace sensors {
+namespace V2_1 {
+namespace implementation {
+
+namespace {
+
+struct SensorState {
+    std::string name;
+    // Whether payload holds the last delivered value.
+    bool delivered = false;
+    int64_t deliveredTimestamp = 0;
+    uint32_t payload[sizeof(Event::u) / sizeof(uint32_t)] = {};
+    uint64_t suppressed = 0;
+    uint64_t heartbeats = 0;
+};
+
+}  // namespace
+
+static int64_t heartbeat_ns;
+
+// Only filtered sensors are added, by init(), before any event is posted.
+static std::unordered_map<int32_t, SensorState> sensor_states;
+static std::mutex state_mutex;
+
+void OnChangeFilter::init(const std::map<int32_t, SensorInfo>& sensors) {
+    int64_t heartbeatMs = GetIntProperty<int64_t>("vendor.sensors.proxy.onchange_heartbeat_ms",
+                                                  1000, 0, INT64_MAX / 1000000);
+    if (heartbeatMs == 0) {
+        ALOGI("On-change de-duplication disabled");
+        return;
+    }
+    heartbeat_ns = heartbeatMs * 1000000;
+
+    for (const auto& [sensorHandle, sensor] : sensors) {
+        if ((sensor.flags & V1_0::SensorFlagBits::MASK_REPORTING_MODE) !=
+                    static_cast<uint32_t>(V1_0::SensorFlagBits::ON_CHANGE_MODE) ||
+            (sensor.flags & V1_0::SensorFlagBits::WAKE_UP) != 0) {
+            continue;
+        }
+        sensor_states[sensorHandle].name = sensor.name;
+    }
+    ALOGI("On-change de-duplication for %zu sensors, heartbeat %" PRId64 " ms",
+          sensor_states.size(), heartbeatMs);
+}
+
+void OnChangeFilter::reset(int32_t sensorHandle) {
+    auto state = sensor_states.find(sensorHandle);
+    if (state == sensor_states.end()) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(state_mutex);
+    state->second.delivered = false;
+}
+
+bool OnChangeFilter::suppress(const Event& event) {
+    if (event.sensorType == SensorType::META_DATA ||
+        event.sensorType == SensorType::ADDITIONAL_INFO) {
+        return false;
+    }
+    auto iter = sensor_states.find(event.sensorHandle);
+    if (iter == sensor_states.end()) {
+        return false;
+    }
+
+    SensorState& state = iter->second;
+    size_t size = CompactEventQueue::payloadWords(event.sensorType) * sizeof(uint32_t);
+    std::lock_guard<std::mutex> lock(state_mutex);
+    if (state.delivered && !memcmp(state.payload, &event.u, size)) {
+        if (event.timestamp - state.deliveredTimestamp < heartbeat_ns) {
+            state.suppressed++;
+            return true;
+        }
+        state.heartbeats++;
+    }
+    state.delivered = true;
+    state.deliveredTimestamp = event.timestamp;
+    memcpy(state.payload, &event.u, size);
+    return false;
+}
+
+void OnChangeFilter::dump(std::ostream& stream) {
+    if (sensor_states.empty()) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(state_mutex);
+    stream << "On-change de-duplication, heartbeat " << heartbeat_ns / 1000000 << " ms:"
+           << std::endl;
+    for (const auto& [sensorHandle, state] : sensor_states) {
+        stream << "  " << state.name << " (0x" << std::hex << sensorHandle << std::dec
+               << "): suppressed " << state.suppressed << ", heartbeats " << state.heartbeats
+               << std::endl;
+    }
+}
+
+}  // namespace implementation
+}  // namespace V2_1
+}  // namespace sensors
+}  // namespace hardware
+}  // namespace android
@@ -0,0 +1,57 @@
+/*
+ * Copyright (C) 2024 The LineageOS Project
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <android/hardware/sensors/2.1/types.h>
+
+#include <map>
+#include <ostream>
+
+namespace android {
+namespace hardware {
+namespace sensors {
+namespace V2_1 {
+namespace implementation {
+
+/**
+ * De-duplication of on-change sensors. Several sub-HAL sensors declared as on-change, e.g.
+ * light, proximity and some oplus virtual sensors, re-report the same value at their polling
+ * rate. Such repeats are dropped before they reach the FMQ, except once every heartbeat, set in
+ * milliseconds through vendor.sensors.proxy.onchange_heartbeat_ms, 0 disabling the filter.
+ *
+ * Only non wake-up sensors are filtered, as the sub-HAL holds a wakelock for every wake-up event
+ * it posts. Meta data events, such as flush complete, are never dropped, and the first event
+ * after the sensor is activated is always delivered.
+ */
+class OnChangeFilter {
+  public:
+    /**
+     * Pick the sensors to filter.
+     *
+     * @param sensors The static sensors of all sub-HALs, keyed by proxy sensor handle.
+     */
+    static void init(const std::map<int32_t, SensorInfo>& sensors);
+
+    /**
+     * Forget the last delivered value, so that the next event of the sensor is delivered.
+     */
+    static void reset(int32_t sensorHandle);
+
+    /**
+     * Whether the event repeats the last delivered value of its sensor and is to be dropped.
+     * Otherwise the event becomes the last delivered value.
+     */
+    static bool suppress(const Event& event);
+
+    static void dump(std::ostream& stream);
+};
+
+}  // namespace implementation
+}  // namespace V2_1
+}  // namespace sensors
+}  // namespace hardware
+}  // namespace android
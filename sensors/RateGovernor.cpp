@@ -0,0 +1,162 @@
+/*
+ * Copyright (C) 2024 The LineageOS Project
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "RateGovernor.h"
+
+#include <android-base/properties.h>
+#include <log/log.h>
+
+#include <algorithm>
+#include <cinttypes>
+#include <iomanip>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+using android::base::GetBoolProperty;
+using android::base::GetIntProperty;
+
+namespace android {
+namespace hardware {
+namespace sensors {
+namespace V2_1 {
+namespace implementation {
+
+namespace {
+
+struct SensorState {
+    std::string name;
+    int64_t periodNs = 0;
+    // Timestamp of the next sampling slot, unset until the first event after a reset.
+    bool started = false;
+    int64_t nextSlotNs = 0;
+    // Since the last reset.
+    uint64_t received = 0;
+    uint64_t delivered = 0;
+    int64_t firstTimestamp = 0;
+    int64_t lastTimestamp = 0;
+    // Since start.
+    uint64_t dropped = 0;
+};
+
+double rateHz(uint64_t count, int64_t spanNs) {
+    return count > 1 && spanNs > 0 ? (count - 1) * 1e9 / spanNs : 0.0;
+}
+
+}  // namespace
+
+static int tolerance_pct;
+
+// Only governed sensors are added, by init(), before any event is posted.
+static std::unordered_map<int32_t, SensorState> sensor_states;
+static std::mutex state_mutex;
+
+void RateGovernor::init(const std::map<int32_t, SensorInfo>& sensors) {
+    if (!GetBoolProperty("vendor.sensors.proxy.rate_governor", true)) {
+        ALOGI("Rate governor disabled");
+        return;
+    }
+    tolerance_pct = GetIntProperty("vendor.sensors.proxy.rate_tolerance_pct", 10, 0, 99);
+
+    for (const auto& [sensorHandle, sensor] : sensors) {
+        if ((sensor.flags & V1_0::SensorFlagBits::MASK_REPORTING_MODE) !=
+                    static_cast<uint32_t>(V1_0::SensorFlagBits::CONTINUOUS_MODE) ||
+            (sensor.flags & V1_0::SensorFlagBits::WAKE_UP) != 0) {
+            continue;
+        }
+        sensor_states[sensorHandle].name = sensor.name;
+    }
+    ALOGI("Rate governor for %zu sensors, tolerance %d%%", sensor_states.size(), tolerance_pct);
+}
+
+void RateGovernor::setPeriod(int32_t sensorHandle, int64_t samplingPeriodNs) {
+    auto state = sensor_states.find(sensorHandle);
+    if (state == sensor_states.end()) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(state_mutex);
+    state->second.periodNs = std::max<int64_t>(samplingPeriodNs, 0);
+    state->second.started = false;
+    state->second.received = 0;
+    state->second.delivered = 0;
+}
+
+void RateGovernor::reset(int32_t sensorHandle) {
+    auto iter = sensor_states.find(sensorHandle);
+    if (iter == sensor_states.end()) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(state_mutex);
+    SensorState& state = iter->second;
+    state.started = false;
+    state.received = 0;
+    state.delivered = 0;
+}
+
+bool RateGovernor::decimate(const Event& event) {
+    if (event.sensorType == SensorType::META_DATA ||
+        event.sensorType == SensorType::ADDITIONAL_INFO) {
+        return false;
+    }
+    auto iter = sensor_states.find(event.sensorHandle);
+    if (iter == sensor_states.end()) {
+        return false;
+    }
+
+    SensorState& state = iter->second;
+    std::lock_guard<std::mutex> lock(state_mutex);
+    if (state.received++ == 0) {
+        state.firstTimestamp = event.timestamp;
+    }
+    state.lastTimestamp = event.timestamp;
+
+    // The slots are spaced by the period less the tolerance, so that a sensor running a bit fast
+    // or with jitter is left alone.
+    int64_t slotNs = state.periodNs - state.periodNs * tolerance_pct / 100;
+    if (state.started && slotNs > 0) {
+        if (event.timestamp < state.nextSlotNs) {
+            state.dropped++;
+            return true;
+        }
+        // Stay on the grid, unless the sensor fell behind by more than a slot.
+        state.nextSlotNs = event.timestamp < state.nextSlotNs + slotNs
+                                   ? state.nextSlotNs + slotNs
+                                   : event.timestamp + slotNs;
+    } else {
+        state.started = true;
+        state.nextSlotNs = event.timestamp + slotNs;
+    }
+    state.delivered++;
+    return false;
+}
+
+void RateGovernor::dump(std::ostream& stream) {
+    if (sensor_states.empty()) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(state_mutex);
+    stream << "Rate governor, tolerance " << tolerance_pct << "%:" << std::endl;
+    auto flags = stream.flags();
+    stream << std::fixed << std::setprecision(1);
+    for (const auto& [sensorHandle, state] : sensor_states) {
+        if (state.periodNs == 0 && state.dropped == 0) {
+            continue;
+        }
+        int64_t spanNs = state.lastTimestamp - state.firstTimestamp;
+        stream << "  " << state.name << ": requested "
+               << (state.periodNs > 0 ? 1e9 / state.periodNs : 0.0) << " Hz, observed "
+               << rateHz(state.received, spanNs) << " Hz, delivered "
+               << rateHz(state.delivered, spanNs) << " Hz, dropped " << state.dropped << std::endl;
+    }
+    stream.flags(flags);
+}
+
+}  // namespace implementation
+}  // namespace V2_1
+}  // namespace sensors
+}  // namespace hardware
+}  // namespace android
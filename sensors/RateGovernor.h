@@ -0,0 +1,64 @@
+/*
+ * Copyright (C) 2024 The LineageOS Project
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <android/hardware/sensors/2.1/types.h>
+
+#include <map>
+#include <ostream>
+
+namespace android {
+namespace hardware {
+namespace sensors {
+namespace V2_1 {
+namespace implementation {
+
+/**
+ * Holds continuous sensors to the sampling period the framework asked for. SSC sensors shared
+ * with other clients on the DSP often run faster than requested, and every extra sample would
+ * still be processed and written to the FMQ.
+ *
+ * Samples are selected by timestamp, on a grid of slots spaced by the requested period less
+ * vendor.sensors.proxy.rate_tolerance_pct percent of it, and the first sample at or after a slot
+ * fills it. The delivered rate thus stays within the tolerance of the requested one whatever the
+ * ratio to the incoming rate, while sensors running only slightly fast are left alone.
+ * vendor.sensors.proxy.rate_governor disables the governor. Wake-up sensors are not governed, as
+ * the sub-HAL holds a wakelock for every wake-up event it posts.
+ */
+class RateGovernor {
+  public:
+    /**
+     * Pick the sensors to govern.
+     *
+     * @param sensors The static sensors of all sub-HALs, keyed by proxy sensor handle.
+     */
+    static void init(const std::map<int32_t, SensorInfo>& sensors);
+
+    /**
+     * Record the sampling period requested through batch() and restart selection.
+     */
+    static void setPeriod(int32_t sensorHandle, int64_t samplingPeriodNs);
+
+    /**
+     * Restart selection and the rate statistics, so that the next event is delivered.
+     */
+    static void reset(int32_t sensorHandle);
+
+    /**
+     * Whether the event arrived ahead of the next sampling slot of its sensor and is to be
+     * dropped.
+     */
+    static bool decimate(const Event& event);
+
+    static void dump(std::ostream& stream);
+};
+
+}  // namespace implementation
+}  // namespace V2_1
+}  // namespace sensors
+}  // namespace hardware
+}  // namespace android
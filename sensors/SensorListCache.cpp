@@ -0,0 +1,339 @@
+/*
+ * Copyright (C) 2024 The LineageOS Project
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "SensorListCache.h"
+
+#include "convertV2_1.h"
+
+#include <android-base/file.h>
+#include <android-base/properties.h>
+#include <android-base/stringprintf.h>
+#include <log/log.h>
+
+#include <elf.h>
+#include <link.h>
+#include <unistd.h>
+
+#include <cstring>
+#include <sstream>
+
+using android::base::Basename;
+using android::base::GetBoolProperty;
+using android::base::GetProperty;
+using android::base::ReadFileToString;
+using android::base::StringAppendF;
+using android::base::WriteStringToFile;
+
+#define CACHE_DIR "/data/vendor/sensors_proxy/"
+
+namespace android {
+namespace hardware {
+namespace sensors {
+namespace V2_1 {
+namespace implementation {
+
+static const std::string kCacheFile = CACHE_DIR "sensor_list";
+static const std::string kCacheTmpFile = CACHE_DIR "sensor_list.tmp";
+static constexpr uint32_t kCacheMagic = 0x4c53504f;  // "OPSL"
+static constexpr uint32_t kCacheVersion = 1;
+
+std::string SensorListCache::sKey;
+hidl_vec<SensorInfo> SensorListCache::sSensorsV2_1;
+hidl_vec<V1_0::SensorInfo> SensorListCache::sSensorsV1_0;
+std::vector<std::vector<uint8_t>> SensorListCache::sWakeUpFlags;
+
+static uint64_t fnv1a(const std::string& data) {
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (unsigned char c : data) {
+        hash ^= c;
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+static size_t noteAlign(size_t size) {
+    return (size + 3) & ~static_cast<size_t>(3);
+}
+
+static int collectBuildId(struct dl_phdr_info* info, size_t /* size */, void* data) {
+    auto* buildIds = static_cast<std::map<std::string, std::string>*>(data);
+    if (info->dlpi_name == nullptr) {
+        return 0;
+    }
+    auto it = buildIds->find(Basename(info->dlpi_name));
+    if (it == buildIds->end() || !it->second.empty()) {
+        return 0;
+    }
+
+    for (int i = 0; i < info->dlpi_phnum; i++) {
+        const ElfW(Phdr)& phdr = info->dlpi_phdr[i];
+        if (phdr.p_type != PT_NOTE) {
+            continue;
+        }
+        const char* note = reinterpret_cast<const char*>(info->dlpi_addr + phdr.p_vaddr);
+        const char* end = note + phdr.p_memsz;
+        while (note + sizeof(ElfW(Nhdr)) <= end) {
+            auto* nhdr = reinterpret_cast<const ElfW(Nhdr)*>(note);
+            const char* name = note + sizeof(ElfW(Nhdr));
+            auto* desc = reinterpret_cast<const uint8_t*>(name + noteAlign(nhdr->n_namesz));
+            if (reinterpret_cast<const char*>(desc) + nhdr->n_descsz > end) {
+                break;
+            }
+            if (nhdr->n_type == NT_GNU_BUILD_ID && nhdr->n_namesz == 4 &&
+                memcmp(name, "GNU", 4) == 0) {
+                for (size_t j = 0; j < nhdr->n_descsz; j++) {
+                    StringAppendF(&it->second, "%02x", desc[j]);
+                }
+                return 0;
+            }
+            note = reinterpret_cast<const char*>(desc) + noteAlign(nhdr->n_descsz);
+        }
+    }
+    return 0;
+}
+
+void SensorListCache::setKey(const char* configFileName,
+                             const std::vector<std::string>& libraries) {
+    sKey.clear();
+    if (!GetBoolProperty("vendor.sensors.proxy.sensor_list_cache", true)) {
+        return;
+    }
+
+    std::string config;
+    if (!ReadFileToString(configFileName, &config)) {
+        return;
+    }
+
+    std::map<std::string, std::string> buildIds;
+    for (const auto& library : libraries) {
+        buildIds[Basename(library)] = "";
+    }
+    dl_iterate_phdr(collectBuildId, &buildIds);
+
+    std::ostringstream key;
+    key << "conf=" << std::hex << fnv1a(config) << std::dec;
+    key << ";vendor=" << GetProperty("ro.vendor.build.fingerprint", "");
+    for (const auto& library : libraries) {
+        const std::string& buildId = buildIds[Basename(library)];
+        if (buildId.empty()) {
+            // Without a build ID there is nothing to tell a rebuilt library apart.
+            ALOGW("No build ID for %s, not caching the sensor list", library.c_str());
+            return;
+        }
+        key << ";" << library << "=" << buildId;
+    }
+    sKey = key.str();
+}
+
+class CacheWriter {
+  public:
+    template <typename T>
+    void put(const T& value) {
+        mData.append(reinterpret_cast<const char*>(&value), sizeof(value));
+    }
+
+    void put(const hidl_string& value) {
+        put(static_cast<uint32_t>(value.size()));
+        mData.append(value.c_str(), value.size());
+    }
+
+    void put(const std::string& value) {
+        put(static_cast<uint32_t>(value.size()));
+        mData.append(value);
+    }
+
+    const std::string& data() const { return mData; }
+
+  private:
+    std::string mData;
+};
+
+class CacheReader {
+  public:
+    explicit CacheReader(const std::string& data) : mData(data) {}
+
+    template <typename T>
+    bool get(T* value) {
+        if (mData.size() - mPos < sizeof(T)) {
+            return false;
+        }
+        memcpy(value, mData.data() + mPos, sizeof(T));
+        mPos += sizeof(T);
+        return true;
+    }
+
+    bool get(std::string* value) {
+        uint32_t size;
+        if (!get(&size) || mData.size() - mPos < size) {
+            return false;
+        }
+        value->assign(mData, mPos, size);
+        mPos += size;
+        return true;
+    }
+
+    bool get(hidl_string* value) {
+        std::string string;
+        if (!get(&string)) {
+            return false;
+        }
+        *value = string;
+        return true;
+    }
+
+    bool done() const { return mPos == mData.size(); }
+
+  private:
+    const std::string& mData;
+    size_t mPos = 0;
+};
+
+static void putSensor(CacheWriter& writer, const SensorInfo& sensor) {
+    writer.put(sensor.sensorHandle);
+    writer.put(sensor.name);
+    writer.put(sensor.vendor);
+    writer.put(sensor.version);
+    writer.put(sensor.type);
+    writer.put(sensor.typeAsString);
+    writer.put(sensor.maxRange);
+    writer.put(sensor.resolution);
+    writer.put(sensor.power);
+    writer.put(sensor.minDelay);
+    writer.put(sensor.fifoReservedEventCount);
+    writer.put(sensor.fifoMaxEventCount);
+    writer.put(sensor.requiredPermission);
+    writer.put(sensor.maxDelay);
+    writer.put(static_cast<uint32_t>(sensor.flags));
+}
+
+static bool getSensor(CacheReader& reader, SensorInfo* sensor) {
+    uint32_t flags;
+    bool ok = reader.get(&sensor->sensorHandle) && reader.get(&sensor->name) &&
+              reader.get(&sensor->vendor) && reader.get(&sensor->version) &&
+              reader.get(&sensor->type) && reader.get(&sensor->typeAsString) &&
+              reader.get(&sensor->maxRange) && reader.get(&sensor->resolution) &&
+              reader.get(&sensor->power) && reader.get(&sensor->minDelay) &&
+              reader.get(&sensor->fifoReservedEventCount) &&
+              reader.get(&sensor->fifoMaxEventCount) && reader.get(&sensor->requiredPermission) &&
+              reader.get(&sensor->maxDelay) && reader.get(&flags);
+    sensor->flags = flags;
+    return ok;
+}
+
+bool SensorListCache::load(size_t numSubHals,
+                           std::vector<std::vector<SensorInfo>>* subHalSensors) {
+    std::string data;
+    if (sKey.empty() || !ReadFileToString(kCacheFile, &data)) {
+        return false;
+    }
+
+    // The checksum covers everything in front of it.
+    uint64_t checksum;
+    if (data.size() < sizeof(checksum)) {
+        return false;
+    }
+    memcpy(&checksum, data.data() + data.size() - sizeof(checksum), sizeof(checksum));
+    data.resize(data.size() - sizeof(checksum));
+    if (fnv1a(data) != checksum) {
+        ALOGW("Sensor list cache is corrupted");
+        return false;
+    }
+
+    CacheReader reader(data);
+    uint32_t magic, version, numLists;
+    std::string key;
+    if (!reader.get(&magic) || magic != kCacheMagic || !reader.get(&version) ||
+        version != kCacheVersion || !reader.get(&key) || key != sKey ||
+        !reader.get(&numLists) || numLists != numSubHals) {
+        ALOGI("Sensor list cache is stale");
+        return false;
+    }
+
+    std::vector<std::vector<SensorInfo>> lists(numLists);
+    for (auto& list : lists) {
+        uint32_t numSensors;
+        if (!reader.get(&numSensors)) {
+            return false;
+        }
+        list.resize(numSensors);
+        for (auto& sensor : list) {
+            if (!getSensor(reader, &sensor)) {
+                return false;
+            }
+        }
+    }
+    if (!reader.done()) {
+        return false;
+    }
+
+    *subHalSensors = std::move(lists);
+    return true;
+}
+
+void SensorListCache::store(const std::vector<std::vector<SensorInfo>>& subHalSensors) {
+    if (sKey.empty()) {
+        return;
+    }
+
+    CacheWriter writer;
+    writer.put(kCacheMagic);
+    writer.put(kCacheVersion);
+    writer.put(sKey);
+    writer.put(static_cast<uint32_t>(subHalSensors.size()));
+    for (const auto& list : subHalSensors) {
+        writer.put(static_cast<uint32_t>(list.size()));
+        for (const auto& sensor : list) {
+            putSensor(writer, sensor);
+        }
+    }
+
+    std::string data = writer.data();
+    uint64_t checksum = fnv1a(data);
+    data.append(reinterpret_cast<const char*>(&checksum), sizeof(checksum));
+    if (!WriteStringToFile(data, kCacheTmpFile) ||
+        rename(kCacheTmpFile.c_str(), kCacheFile.c_str()) != 0) {
+        ALOGW("Failed to write sensor list cache");
+        unlink(kCacheTmpFile.c_str());
+    }
+}
+
+void SensorListCache::publish(const std::map<int32_t, SensorInfo>& sensors) {
+    std::vector<SensorInfo> sensorsV2_1;
+    std::vector<V1_0::SensorInfo> sensorsV1_0;
+    for (const auto& iter : sensors) {
+        sensorsV2_1.push_back(iter.second);
+        if (iter.second.type != SensorType::HINGE_ANGLE) {
+            sensorsV1_0.push_back(convertToOldSensorInfo(iter.second));
+        }
+    }
+    sSensorsV2_1 = sensorsV2_1;
+    sSensorsV1_0 = sensorsV1_0;
+
+    std::vector<std::vector<uint8_t>> wakeUpFlags;
+    for (const auto& iter : sensors) {
+        uint32_t subHalIndex = static_cast<uint32_t>(iter.first) >> kBitsAfterSubHalIndex;
+        uint32_t handle = static_cast<uint32_t>(iter.first) & kSubHalHandleMask;
+        if (handle >= kMaxFlatHandle) {
+            continue;
+        }
+        if (subHalIndex >= wakeUpFlags.size()) {
+            wakeUpFlags.resize(subHalIndex + 1);
+        }
+        std::vector<uint8_t>& flags = wakeUpFlags[subHalIndex];
+        if (handle >= flags.size()) {
+            flags.resize(handle + 1, kFlagUnknown);
+        }
+        flags[handle] = (iter.second.flags & V1_0::SensorFlagBits::WAKE_UP) != 0 ? kFlagWakeUp
+                                                                                 : kFlagNonWakeUp;
+    }
+    sWakeUpFlags = std::move(wakeUpFlags);
+}
+
+}  // namespace implementation
+}  // namespace V2_1
+}  // namespace sensors
+}  // namespace hardware
+}  // namespace android
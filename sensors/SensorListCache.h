@@ -0,0 +1,106 @@
+/*
+ * Copyright (C) 2024 The LineageOS Project
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <android/hardware/sensors/1.0/types.h>
+#include <android/hardware/sensors/2.1/types.h>
+#include <hidl/HidlSupport.h>
+
+#include <map>
+#include <string>
+#include <vector>
+
+namespace android {
+namespace hardware {
+namespace sensors {
+namespace V2_1 {
+namespace implementation {
+
+/**
+ * Keeps the sensor lists reported by the sub-HALs on disk so a restarted HAL can skip the
+ * enumeration, and holds the merged list the framework queries, built once, along with the
+ * per-sensor flags the event path needs.
+ *
+ * The on-disk cache is only used when it was written for the same hals.conf contents, the same
+ * sub-HAL library build IDs and the same vendor build.
+ */
+class SensorListCache {
+  public:
+    /**
+     * Compute the cache key for the sub-HALs listed in the config file. Has to be called after
+     * the sub-HAL libraries have been loaded, as the build IDs are read from the loaded images.
+     * Without a key, load() and store() do nothing.
+     *
+     * @param configFileName The multi-HAL config file listing the sub-HAL libraries.
+     * @param libraries The sub-HAL libraries that were loaded, in sub-HAL index order.
+     */
+    static void setKey(const char* configFileName, const std::vector<std::string>& libraries);
+
+    /**
+     * Load the raw sensor lists of every sub-HAL.
+     *
+     * @param numSubHals The number of sub-HALs the lists are expected for.
+     * @param subHalSensors Filled with one list per sub-HAL, indexed like the sub-HAL list.
+     *
+     * @return true if a valid cache matching the current key was found.
+     */
+    static bool load(size_t numSubHals, std::vector<std::vector<SensorInfo>>* subHalSensors);
+
+    /**
+     * Store the raw sensor lists of every sub-HAL.
+     */
+    static void store(const std::vector<std::vector<SensorInfo>>& subHalSensors);
+
+    /**
+     * Build the lists served to the framework from the merged sensors.
+     */
+    static void publish(const std::map<int32_t, SensorInfo>& sensors);
+
+    static const hidl_vec<SensorInfo>& getSensorsList_2_1() { return sSensorsV2_1; }
+    static const hidl_vec<V1_0::SensorInfo>& getSensorsList() { return sSensorsV1_0; }
+
+    /**
+     * Look up whether a sensor wakes up the AP in the flat table built by publish(), so that
+     * the event path does not have to ask HalProxy for every event. Dynamic sensors and sub-HAL
+     * handles of kMaxFlatHandle or more are not in the table.
+     *
+     * @param sensorHandle The proxy sensor handle, with the sub-HAL index set.
+     * @param wakeUp Set to whether the sensor is a wake-up sensor.
+     *
+     * @return false if the sensor is not in the table.
+     */
+    static inline bool lookupWakeUp(int32_t sensorHandle, bool* wakeUp) {
+        uint32_t subHalIndex = static_cast<uint32_t>(sensorHandle) >> kBitsAfterSubHalIndex;
+        uint32_t handle = static_cast<uint32_t>(sensorHandle) & kSubHalHandleMask;
+        if (subHalIndex >= sWakeUpFlags.size() || handle >= sWakeUpFlags[subHalIndex].size() ||
+            sWakeUpFlags[subHalIndex][handle] == kFlagUnknown) {
+            return false;
+        }
+        *wakeUp = sWakeUpFlags[subHalIndex][handle] == kFlagWakeUp;
+        return true;
+    }
+
+    static constexpr uint32_t kMaxFlatHandle = 1024;
+
+  private:
+    static constexpr int kBitsAfterSubHalIndex = 24;
+    static constexpr uint32_t kSubHalHandleMask = (1u << kBitsAfterSubHalIndex) - 1;
+
+    enum : uint8_t { kFlagUnknown, kFlagNonWakeUp, kFlagWakeUp };
+
+    static std::string sKey;
+    static hidl_vec<SensorInfo> sSensorsV2_1;
+    static hidl_vec<V1_0::SensorInfo> sSensorsV1_0;
+    // Indexed by sub-HAL index, then by sub-HAL sensor handle.
+    static std::vector<std::vector<uint8_t>> sWakeUpFlags;
+};
+
+}  // namespace implementation
+}  // namespace V2_1
+}  // namespace sensors
+}  // namespace hardware
+}  // namespace android
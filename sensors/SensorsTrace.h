@@ -0,0 +1,36 @@
+/*
+ * Copyright (C) 2024 The LineageOS Project
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+/**
+ * Trace points of the sensor event pipeline. They are only compiled in when SENSORS_TRACE is
+ * defined, which Android.bp does for debuggable builds. The slices and counters go through
+ * atrace under the "hal" category, so a perfetto config with atrace_categories: "hal" lines
+ * them up against the sched events; when that category is off each point costs one atomic load.
+ */
+#ifdef SENSORS_TRACE
+
+#include <cutils/trace.h>
+#include <utils/Trace.h>
+
+#define SENSORS_TRACE_CONCAT_(a, b) a##b
+#define SENSORS_TRACE_CONCAT(a, b) SENSORS_TRACE_CONCAT_(a, b)
+
+//! Trace a slice from here to the end of the enclosing scope.
+#define SENSORS_TRACE_SCOPE(name) \
+    ::android::ScopedTrace SENSORS_TRACE_CONCAT(sensorsTrace, __LINE__)(ATRACE_TAG_HAL, name)
+
+//! Update a counter track.
+#define SENSORS_TRACE_COUNTER(name, value) \
+    atrace_int64(ATRACE_TAG_HAL, name, static_cast<int64_t>(value))
+
+#else
+
+#define SENSORS_TRACE_SCOPE(name)
+#define SENSORS_TRACE_COUNTER(name, value)
+
+#endif
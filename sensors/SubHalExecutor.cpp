@@ -0,0 +1,152 @@
+/*
+ * Copyright (C) 2024 The LineageOS Project
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "SubHalExecutor.h"
+
+#include "ThreadPolicy.h"
+
+#include <log/log.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cinttypes>
+
+namespace android {
+namespace hardware {
+namespace sensors {
+namespace V2_1 {
+namespace implementation {
+
+static int64_t nowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                   std::chrono::steady_clock::now().time_since_epoch())
+            .count();
+}
+
+SubHalExecutor::~SubHalExecutor() {
+    stop();
+}
+
+void SubHalExecutor::start(size_t numSubHals) {
+    std::lock_guard<std::mutex> lock(mLanesMutex);
+    while (mLanes.size() < numSubHals) {
+        auto lane = std::make_unique<Lane>();
+        lane->index = mLanes.size();
+        lane->thread = std::thread(runLane, lane.get());
+        mLanes.push_back(std::move(lane));
+    }
+}
+
+void SubHalExecutor::stop() {
+    std::lock_guard<std::mutex> lock(mLanesMutex);
+    for (auto& lane : mLanes) {
+        {
+            std::lock_guard<std::mutex> laneLock(lane->mutex);
+            lane->running = false;
+        }
+        lane->cv.notify_one();
+        if (lane->thread.joinable()) {
+            lane->thread.join();
+        }
+    }
+    mLanes.clear();
+}
+
+std::future<SubHalExecutor::Result> SubHalExecutor::post(size_t subHalIndex, const char* op,
+                                                         Task task) {
+    std::promise<Result> promise;
+    std::future<Result> result = promise.get_future();
+
+    Lane* lane = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(mLanesMutex);
+        if (subHalIndex < mLanes.size()) {
+            lane = mLanes[subHalIndex].get();
+        }
+    }
+    if (lane == nullptr) {
+        // No lane to run on, keep the old serial behaviour.
+        ALOGW("No executor lane for sub-HAL %zu, running %s inline", subHalIndex, op);
+        promise.set_value(task());
+        return result;
+    }
+
+    {
+        std::lock_guard<std::mutex> laneLock(lane->mutex);
+        lane->queue.push_back({op, std::move(task), std::move(promise)});
+    }
+    lane->cv.notify_one();
+    return result;
+}
+
+SubHalExecutor::Result SubHalExecutor::waitAll(std::vector<std::future<Result>>& results) {
+    Result result = Result::OK;
+    for (auto& future : results) {
+        Result currRes = future.get();
+        if (result == Result::OK && currRes != Result::OK) {
+            result = currRes;
+        }
+    }
+    return result;
+}
+
+void SubHalExecutor::runLane(Lane* lane) {
+    ThreadPolicy::apply("config", "HalProxyCfg" + std::to_string(lane->index));
+
+    std::unique_lock<std::mutex> lock(lane->mutex);
+    while (true) {
+        lane->cv.wait(lock, [&] { return !lane->queue.empty() || !lane->running; });
+        if (lane->queue.empty()) {
+            // Only reached once stopped, queued calls are always drained first.
+            break;
+        }
+        Call call = std::move(lane->queue.front());
+        lane->queue.pop_front();
+        lock.unlock();
+
+        int64_t start = nowNs();
+        Result result = call.task();
+        int64_t elapsed = nowNs() - start;
+        call.result.set_value(result);
+        if (elapsed > kSlowCallNs) {
+            ALOGW("%s on sub-HAL %zu took %" PRId64 " ms", call.op, lane->index,
+                  elapsed / 1000000);
+        }
+
+        lock.lock();
+        CallStats& stats = lane->stats[call.op];
+        stats.count++;
+        if (result != Result::OK) {
+            stats.failures++;
+        }
+        stats.totalNs += elapsed;
+        stats.maxNs = std::max(stats.maxNs, elapsed);
+        stats.lastNs = elapsed;
+    }
+}
+
+void SubHalExecutor::dump(std::ostream& stream, size_t subHalIndex) {
+    std::lock_guard<std::mutex> lock(mLanesMutex);
+    if (subHalIndex >= mLanes.size()) {
+        return;
+    }
+    Lane* lane = mLanes[subHalIndex].get();
+    std::lock_guard<std::mutex> laneLock(lane->mutex);
+    stream << "  Config calls (" << lane->queue.size() << " queued):" << std::endl;
+    for (const auto& [op, stats] : lane->stats) {
+        stream << "    " << op << ": count=" << stats.count
+               << " avg=" << stats.totalNs / static_cast<int64_t>(stats.count) / 1000 << "us"
+               << " max=" << stats.maxNs / 1000 << "us"
+               << " last=" << stats.lastNs / 1000 << "us"
+               << " failures=" << stats.failures << std::endl;
+    }
+}
+
+}  // namespace implementation
+}  // namespace V2_1
+}  // namespace sensors
+}  // namespace hardware
+}  // namespace android
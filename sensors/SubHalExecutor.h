@@ -0,0 +1,114 @@
+/*
+ * Copyright (C) 2024 The LineageOS Project
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <android/hardware/sensors/1.0/types.h>
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace android {
+namespace hardware {
+namespace sensors {
+namespace V2_1 {
+namespace implementation {
+
+/**
+ * Fans configuration calls out to the sub-HALs. Every sub-HAL owns a lane, a worker thread
+ * draining a FIFO of calls, so calls into one sub-HAL keep the order they were posted in while
+ * a slow firmware round trip in one sub-HAL doesn't hold up the others.
+ */
+class SubHalExecutor {
+  public:
+    using Result = ::android::hardware::sensors::V1_0::Result;
+    using Task = std::function<Result()>;
+
+    ~SubHalExecutor();
+
+    /**
+     * Start one lane per sub-HAL. Lanes that were already running are kept.
+     *
+     * @param numSubHals The number of sub-HALs loaded by the proxy.
+     */
+    void start(size_t numSubHals);
+
+    /**
+     * Drain all queued calls and join the lane threads.
+     */
+    void stop();
+
+    /**
+     * Queue a call on the lane of the given sub-HAL.
+     *
+     * @param subHalIndex The index of the sub-HAL the call is made into.
+     * @param op A short name for the call, used to aggregate latency stats.
+     * @param task The call itself.
+     *
+     * @return A future holding the result of the call.
+     */
+    std::future<Result> post(size_t subHalIndex, const char* op, Task task);
+
+    /**
+     * Wait for every future to complete.
+     *
+     * @return The first result that was not OK, or OK if all calls succeeded.
+     */
+    static Result waitAll(std::vector<std::future<Result>>& results);
+
+    /**
+     * Write the per-call latency stats of a lane to the stream.
+     */
+    void dump(std::ostream& stream, size_t subHalIndex);
+
+  private:
+    struct CallStats {
+        uint64_t count = 0;
+        uint64_t failures = 0;
+        int64_t totalNs = 0;
+        int64_t maxNs = 0;
+        int64_t lastNs = 0;
+    };
+
+    struct Call {
+        const char* op;
+        Task task;
+        std::promise<Result> result;
+    };
+
+    struct Lane {
+        size_t index;
+        std::thread thread;
+        std::mutex mutex;
+        std::condition_variable cv;
+        std::deque<Call> queue;
+        bool running = true;
+        std::map<std::string, CallStats> stats;
+    };
+
+    static void runLane(Lane* lane);
+
+    //! Calls taking longer than this are logged as they complete.
+    static constexpr int64_t kSlowCallNs = 100 * 1000000LL /* 100 ms */;
+
+    std::mutex mLanesMutex;
+    std::vector<std::unique_ptr<Lane>> mLanes;
+};
+
+}  // namespace implementation
+}  // namespace V2_1
+}  // namespace sensors
+}  // namespace hardware
+}  // namespace android
@@ -0,0 +1,228 @@
+/*
+ * Copyright (C) 2024 The LineageOS Project
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "ThreadPolicy.h"
+
+#include <android-base/file.h>
+#include <android-base/parseint.h>
+#include <android-base/properties.h>
+#include <android-base/strings.h>
+#include <log/log.h>
+
+#include <pthread.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <sstream>
+
+using android::base::GetBoolProperty;
+using android::base::GetIntProperty;
+using android::base::GetProperty;
+using android::base::ParseUint;
+using android::base::ReadFileToString;
+using android::base::Split;
+using android::base::Trim;
+using android::base::WriteStringToFile;
+
+#define PROPERTY_PREFIX "vendor.sensors.proxy."
+#define CPUSET_PATH "/dev/cpuset/"
+
+namespace android {
+namespace hardware {
+namespace sensors {
+namespace V2_1 {
+namespace implementation {
+
+// Not exported by bionic, see include/uapi/linux/sched/types.h
+struct sched_attr {
+    uint32_t size;
+    uint32_t sched_policy;
+    uint64_t sched_flags;
+    int32_t sched_nice;
+    uint32_t sched_priority;
+    uint64_t sched_runtime;
+    uint64_t sched_deadline;
+    uint64_t sched_period;
+    uint32_t sched_util_min;
+    uint32_t sched_util_max;
+};
+
+static constexpr uint64_t kSchedFlagKeepAll = 0x08 | 0x10;
+static constexpr uint64_t kSchedFlagUtilClampMin = 0x20;
+static constexpr uint64_t kSchedFlagUtilClampMax = 0x40;
+static constexpr int kUclampMax = 1024;
+
+struct EffectivePolicy {
+    std::string policy;
+    pid_t tid;
+    int schedPolicy;
+    int priority;
+    std::string cpuset;
+    std::string cpus;
+    int uclampMin;
+    int uclampMax;
+    std::string errors;
+};
+
+static std::mutex sPoliciesMutex;
+static std::map<std::string, EffectivePolicy> sPolicies;
+
+static bool parseCpuList(const std::string& list, cpu_set_t* set) {
+    CPU_ZERO(set);
+    for (const auto& range : Split(list, ",")) {
+        std::vector<std::string> bounds = Split(range, "-");
+        unsigned int first, last;
+        if (bounds.size() > 2 || !ParseUint(bounds[0], &first, CPU_SETSIZE - 1u)) {
+            return false;
+        }
+        last = first;
+        if (bounds.size() == 2 && !ParseUint(bounds[1], &last, CPU_SETSIZE - 1u)) {
+            return false;
+        }
+        for (unsigned int cpu = first; cpu <= last; cpu++) {
+            CPU_SET(cpu, set);
+        }
+    }
+    return CPU_COUNT(set) > 0;
+}
+
+static std::string formatCpuList(const cpu_set_t& set) {
+    std::ostringstream stream;
+    for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+        if (CPU_ISSET(cpu, &set)) {
+            if (stream.tellp() > 0) {
+                stream << ",";
+            }
+            stream << cpu;
+        }
+    }
+    return stream.str();
+}
+
+void ThreadPolicy::apply(const std::string& policy, const std::string& threadName) {
+    std::string prefix = PROPERTY_PREFIX + policy + ".";
+    int priority = 0;
+    if (GetBoolProperty(PROPERTY_PREFIX "realtime", false)) {
+        priority = GetIntProperty(prefix + "priority", 0, 0, sched_get_priority_max(SCHED_FIFO));
+    }
+    std::string cpuset = GetProperty(prefix + "cpuset", "");
+    std::string cpus = GetProperty(prefix + "cpus", "");
+    int uclampMin = GetIntProperty(prefix + "uclamp_min", -1, 0, kUclampMax);
+    int uclampMax = GetIntProperty(prefix + "uclamp_max", -1, 0, kUclampMax);
+
+    std::ostringstream errors;
+    pthread_setname_np(pthread_self(), threadName.c_str());
+
+    if (priority > 0) {
+        struct sched_param param = {.sched_priority = priority};
+        if (sched_setscheduler(0, SCHED_FIFO, &param) != 0) {
+            errors << " priority: " << strerror(errno);
+        }
+    }
+
+    // The affinity is bounded by the cpuset, so move the thread first.
+    if (!cpuset.empty()) {
+        if (cpuset.find('/') != std::string::npos || cpuset.find("..") != std::string::npos) {
+            errors << " cpuset: invalid name '" << cpuset << "'";
+        } else if (!WriteStringToFile(std::to_string(gettid()),
+                                      CPUSET_PATH + cpuset + "/tasks")) {
+            errors << " cpuset: " << strerror(errno);
+        }
+    }
+
+    if (!cpus.empty()) {
+        cpu_set_t set;
+        if (!parseCpuList(cpus, &set)) {
+            errors << " cpus: invalid list '" << cpus << "'";
+        } else if (sched_setaffinity(0, sizeof(set), &set) != 0) {
+            errors << " cpus: " << strerror(errno);
+        }
+    }
+
+    if (uclampMin >= 0 || uclampMax >= 0) {
+        struct sched_attr attr = {};
+        attr.size = sizeof(attr);
+        attr.sched_flags = kSchedFlagKeepAll;
+        if (uclampMin >= 0) {
+            attr.sched_flags |= kSchedFlagUtilClampMin;
+            attr.sched_util_min = uclampMin;
+        }
+        if (uclampMax >= 0) {
+            attr.sched_flags |= kSchedFlagUtilClampMax;
+            attr.sched_util_max = uclampMax;
+        }
+        if (syscall(__NR_sched_setattr, 0, &attr, 0) != 0) {
+            // Kernels without CONFIG_UCLAMP_TASK reject the flags, keep going without the hint.
+            errors << " uclamp: " << strerror(errno);
+            uclampMin = uclampMax = -1;
+        }
+    }
+
+    std::string errorString = errors.str();
+    if (!errorString.empty()) {
+        ALOGW("Failed to apply %s policy to %s:%s", policy.c_str(), threadName.c_str(),
+              errorString.c_str());
+    }
+
+    // Record what the kernel actually gave us rather than what was asked for.
+    EffectivePolicy effective = {
+            .policy = policy,
+            .tid = gettid(),
+            .schedPolicy = sched_getscheduler(0),
+            .priority = 0,
+            .uclampMin = uclampMin,
+            .uclampMax = uclampMax,
+            .errors = errorString,
+    };
+    struct sched_param param;
+    if (sched_getparam(0, &param) == 0) {
+        effective.priority = param.sched_priority;
+    }
+    std::string cpusetPath;
+    if (ReadFileToString("/proc/self/task/" + std::to_string(effective.tid) + "/cpuset",
+                         &cpusetPath)) {
+        effective.cpuset = Trim(cpusetPath);
+    }
+    cpu_set_t set;
+    if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+        effective.cpus = formatCpuList(set);
+    }
+
+    std::lock_guard<std::mutex> lock(sPoliciesMutex);
+    sPolicies[threadName] = effective;
+}
+
+void ThreadPolicy::dump(std::ostream& stream) {
+    std::lock_guard<std::mutex> lock(sPoliciesMutex);
+    stream << "Thread policies:" << std::endl;
+    for (const auto& [threadName, effective] : sPolicies) {
+        stream << "  " << threadName << " (" << effective.policy << ", tid " << effective.tid
+               << "): " << (effective.schedPolicy == SCHED_FIFO ? "SCHED_FIFO" : "SCHED_OTHER")
+               << " prio=" << effective.priority << " cpuset=" << effective.cpuset
+               << " cpus=" << effective.cpus;
+        if (effective.uclampMin >= 0) {
+            stream << " uclamp_min=" << effective.uclampMin;
+        }
+        if (effective.uclampMax >= 0) {
+            stream << " uclamp_max=" << effective.uclampMax;
+        }
+        if (!effective.errors.empty()) {
+            stream << " errors:" << effective.errors;
+        }
+        stream << std::endl;
+    }
+}
+
+}  // namespace implementation
+}  // namespace V2_1
+}  // namespace sensors
+}  // namespace hardware
+}  // namespace android
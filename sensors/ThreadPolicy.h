@@ -0,0 +1,51 @@
+/*
+ * Copyright (C) 2024 The LineageOS Project
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <ostream>
+#include <string>
+
+namespace android {
+namespace hardware {
+namespace sensors {
+namespace V2_1 {
+namespace implementation {
+
+/**
+ * Scheduling policy for the threads owned by the proxy. Each thread class reads its policy from
+ * vendor.sensors.proxy.<policy>.* when it starts:
+ *
+ *   priority    SCHED_FIFO priority, 0 keeps the thread on SCHED_OTHER
+ *   cpuset      Cpuset the thread is moved to, e.g. "foreground", instead of the service one
+ *   cpus        CPU list the thread is pinned to within its cpuset, e.g. "4-6" or "0,4"
+ *   uclamp_min  Minimum utilization clamp, 0-1024
+ *   uclamp_max  Maximum utilization clamp, 0-1024
+ *
+ * The priorities only take effect once vendor.sensors.proxy.realtime is set, so that products
+ * opt into SCHED_FIFO explicitly.
+ */
+class ThreadPolicy {
+  public:
+    /**
+     * Name the calling thread and apply the policy configured for it.
+     *
+     * @param policy The property namespace of the policy, e.g. "pending_writes".
+     * @param threadName The name given to the thread, at most 15 characters.
+     */
+    static void apply(const std::string& policy, const std::string& threadName);
+
+    /**
+     * Write the policy that is in effect for every thread seen by apply() to the stream.
+     */
+    static void dump(std::ostream& stream);
+};
+
+}  // namespace implementation
+}  // namespace V2_1
+}  // namespace sensors
+}  // namespace hardware
+}  // namespace android